@@ -0,0 +1,88 @@
+//------------------------------------------------------------------------------
+// CompactExpression.h
+// Compact post-order encoding of bound expression trees.
+//
+// File is under the MIT license; see LICENSE for details.
+//------------------------------------------------------------------------------
+#pragma once
+
+#include <vector>
+
+#include "slang/binding/Expressions.h"
+
+namespace slang {
+
+/// A compact encoding of one or more bound expression trees, intended for analyses that
+/// need to scan large numbers of expressions (every continuous assignment in a design,
+/// for example) as quickly as possible.
+///
+/// Nodes are stored contiguously in post-order, so every node comes after all of its
+/// children, and the structure of the tree is described by indices instead of pointers.
+/// A linear scan over the nodes visits every subexpression without chasing any pointers;
+/// each node still links back to the Expression it was created from for anything
+/// not captured in the encoding itself.
+class CompactExpressionSet {
+public:
+    /// A single node in the encoding.
+    struct Node {
+        /// The kind of expression this node represents.
+        ExpressionKind kind;
+
+        /// The operator, for unary and binary operators and compound assignments,
+        /// or the selection kind for range selects. Zero otherwise.
+        uint8_t op = 0;
+
+        /// The number of child nodes.
+        uint32_t numChildren = 0;
+
+        /// The offset of this node's first child index in the child index list.
+        uint32_t firstChild = 0;
+
+        /// The type of the expression.
+        const Type* type;
+
+        /// The expression that this node was created from.
+        const Expression* expr;
+    };
+
+    /// Encodes the given expression tree and adds it to the set.
+    /// Returns the index of the new tree's root node.
+    uint32_t add(const Expression& expr);
+
+    /// Gets all nodes in the set, in post-order.
+    span<const Node> nodes() const { return nodes_; }
+
+    /// Gets the indices of the root node of each tree that has been added.
+    span<const uint32_t> roots() const { return roots_; }
+
+    /// Gets the node at the given index.
+    const Node& operator[](uint32_t index) const { return nodes_[index]; }
+
+    /// Gets the indices of the children of the given node, in operand order.
+    span<const uint32_t> children(const Node& node) const {
+        return span<const uint32_t>(childIndices.data() + node.firstChild, node.numChildren);
+    }
+
+    /// Gets the index of the first node belonging to the tree with the given root.
+    /// The nodes of the tree are the ones in the range [treeStart(root), root].
+    uint32_t treeStart(uint32_t root) const;
+
+    /// The total number of nodes in the set.
+    size_t size() const { return nodes_.size(); }
+    bool empty() const { return nodes_.empty(); }
+
+    auto begin() const { return nodes_.begin(); }
+    auto end() const { return nodes_.end(); }
+
+private:
+    uint32_t encode(const Expression& expr);
+
+    std::vector<Node> nodes_;
+    std::vector<uint32_t> roots_;
+    std::vector<uint32_t> childIndices;
+
+    // Number of nodes in the subtree rooted at each node, used to find tree boundaries.
+    std::vector<uint32_t> subtreeSizes;
+};
+
+} // namespace slang
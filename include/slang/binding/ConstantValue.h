@@ -64,8 +64,15 @@ public:
 
     std::string toString() const;
 
+    /// Computes a hash of the value, suitable for use as a key in caches of evaluated results.
+    size_t hash(size_t seed = 0) const;
+
     static const ConstantValue Invalid;
 
+    /// Determines whether the two values are exactly the same: same kind of value,
+    /// and for integers, same width, signedness, and bit pattern (including unknown bits).
+    friend bool exactlyEqual(const ConstantValue& lhs, const ConstantValue& rhs);
+
     friend void to_json(json& j, const ConstantValue& cv);
     friend std::ostream& operator<<(std::ostream& os, const ConstantValue& cv);
 
@@ -6,8 +6,8 @@
 //------------------------------------------------------------------------------
 #pragma once
 
+#include <chrono>
 #include <map>
-#include <stack>
 #include <vector>
 
 #include "slang/binding/ConstantValue.h"
@@ -25,9 +25,10 @@ class EvalContext {
 public:
     /// Represents a single frame in the call stack.
     struct Frame {
-        /// A set of temporary values materialized within the stack frame.
-        /// Uses a map so that the values don't move around in memory.
-        std::map<const ValueSymbol*, ConstantValue> temporaries;
+        /// Storage for the locals of the executing subroutine, indexed by the slot
+        /// layout precomputed for it (see SubroutineSymbol::getLocalSlots). The storage
+        /// is sized once when the frame is pushed so values never move around in memory.
+        std::vector<ConstantValue> locals;
 
         /// The function that is being executed in this frame, if any.
         const SubroutineSymbol* subroutine = nullptr;
@@ -38,6 +39,19 @@ public:
         /// The lookup location of the function call site.
         LookupLocation lookupLocation;
 
+        /// Set if anything evaluated in this frame (or a frame called from it) depended on
+        /// state other than the subroutine's arguments, such as parameter values. Results
+        /// of such calls can't be reused for other calls with the same arguments.
+        bool dependsOnContext = false;
+
+        /// The number of expressions and loop iterations evaluated in this frame and all
+        /// frames called from it. Only tracked when profiling is enabled.
+        uint64_t expressions = 0;
+        uint64_t loopIterations = 0;
+
+        /// The time at which the frame was pushed. Only set when profiling is enabled.
+        std::chrono::steady_clock::time_point startTime;
+
         // TODO: remove this
         bool hasReturned = false;
     };
@@ -51,13 +65,43 @@ public:
     /// Returns nullptr if the symbol cannot be found.
     ConstantValue* findLocal(const ValueSymbol* symbol);
 
-    /// Push a new frame onto the call stack.
-    void pushFrame(const SubroutineSymbol& subroutine, SourceLocation callLocation,
+    /// Push a new frame onto the call stack. Returns false if doing so would exceed the
+    /// maximum call depth, in which case a diagnostic is issued and no frame is pushed.
+    bool pushFrame(const SubroutineSymbol& subroutine, SourceLocation callLocation,
                    LookupLocation lookupLocation);
 
     /// Pop the active frame from the call stack and returns its value, if any.
     ConstantValue popFrame();
 
+    /// Gets the compilation that tracks cached results and profiles for a call to the given
+    /// subroutine from the given location. This is normally the subroutine's own compilation,
+    /// but frozen compilations are shared and can't be modified, so calls into one of those
+    /// are tracked by the calling compilation instead.
+    static Compilation& getCallCompilation(const SubroutineSymbol& subroutine,
+                                           LookupLocation lookupLocation);
+
+    /// Marks the active frame as depending on state other than its arguments.
+    void markContextDependent() { stack.back().dependsOnContext = true; }
+
+    /// Records one step of evaluation (a loop iteration or function call) and checks it
+    /// against the evaluation budget configured in the compilation options. Returns false
+    /// if the budget has been exhausted, in which case a diagnostic has been issued
+    /// and evaluation should stop.
+    bool step(SourceLocation location);
+
+    /// Records a loop iteration for profiling, and checks it against the step budget.
+    bool stepLoop(SourceLocation location) {
+        if (profiling)
+            stack.back().loopIterations++;
+        return step(location);
+    }
+
+    /// Records the evaluation of an expression for profiling purposes.
+    void countExpression() {
+        if (profiling)
+            stack.back().expressions++;
+    }
+
     /// Indicates whether this evaluation context is for a script session
     /// (not used during normal compilation flow).
     bool isScriptEval() const { return isScriptEval_; }
@@ -82,7 +126,27 @@ public:
 private:
     void reportStack();
 
-    std::deque<Frame> stack;
+    std::vector<Frame> stack;
+
+    // Limits on how much work evaluation is allowed to do, pulled from the compilation
+    // options when the first subroutine frame is pushed. Zero means no limit.
+    uint64_t steps = 0;
+    uint64_t maxSteps = 0;
+    uint32_t maxDepth = 0;
+    std::chrono::milliseconds maxTime{ 0 };
+    std::chrono::steady_clock::time_point startTime;
+    bool limitsInitialized = false;
+    bool budgetExceeded = false;
+    bool profiling = false;
+
+    // Temporary values materialized outside of any subroutine, such as genvars
+    // and script variables. Uses a map so that the values don't move around in memory.
+    std::map<const ValueSymbol*, ConstantValue> temporaries;
+
+    // Local storage from popped frames, kept around so that subsequent calls
+    // can reuse it instead of allocating again.
+    std::vector<std::vector<ConstantValue>> localsPool;
+
     Diagnostics diags;
     bool reportedCallstack = false;
     bool isScriptEval_ = false;
@@ -206,6 +206,14 @@ protected:
         Compilation& compilation, const ExpressionSyntax& syntax, const BindContext& context,
         bitmask<BindFlags> extraFlags = BindFlags::None);
     struct PropagationVisitor;
+
+private:
+    // Binds via the given function, reusing a previously bound result if the expression
+    // doesn't depend on the scope it's bound in.
+    template<typename TBind>
+    static const Expression& bindCached(Compilation& compilation, const ExpressionSyntax& syntax,
+                                        const Type* targetType, const BindContext& context,
+                                        TBind&& bindFunc);
 };
 
 /// Represents an invalid expression, which is usually generated and inserted
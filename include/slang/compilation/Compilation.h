@@ -6,12 +6,14 @@
 //------------------------------------------------------------------------------
 #pragma once
 
+#include <chrono>
 #include <memory>
 
 #include "slang/binding/Expressions.h"
 #include "slang/diagnostics/Diagnostics.h"
 #include "slang/symbols/HierarchySymbols.h"
 #include "slang/symbols/TypeSymbols.h"
+#include "slang/util/Bag.h"
 #include "slang/util/BumpAllocator.h"
 #include "slang/util/SafeIndexedVector.h"
 #include "slang/util/SmallVector.h"
@@ -22,12 +24,101 @@ class SyntaxTree;
 class SystemSubroutine;
 struct CompilationUnitSyntax;
 
+/// Contains various options that can control compilation behavior.
+struct CompilationOptions {
+    /// If true, the results of calls to user-defined constant functions are cached
+    /// and reused when the same function is called again with identical arguments.
+    /// Only results that depend solely on the arguments of the call are cached.
+    bool memoizeConstantFunctions = false;
+
+    /// The maximum depth of nested calls to constant functions allowed while evaluating
+    /// a single constant expression. Zero, the default, means no limit.
+    uint32_t maxConstexprDepth = 0;
+
+    /// The maximum number of steps (function calls plus loop iterations) allowed while
+    /// evaluating a single constant expression. Zero, the default, means no limit.
+    uint64_t maxConstexprSteps = 0;
+
+    /// The maximum amount of time allowed to be spent evaluating a single constant
+    /// expression. Zero, the default, means no limit.
+    std::chrono::milliseconds maxConstexprTime{ 0 };
+
+    /// If true, calls to constant functions are profiled; the results are available
+    /// via @a Compilation::getConstantCallProfile.
+    bool profileConstantFunctions = false;
+
+    /// If true, instances of a definition that have identical parameter override values
+    /// share their conditional generate selections instead of each evaluating the
+    /// conditions separately.
+    bool cacheDefinitionSpecializations = true;
+
+    /// If true, expressions whose meaning doesn't depend on where they're bound (those made up
+    /// of only literals, operators, and references to package members) are bound once and then
+    /// shared by every scope that binds the same syntax, such as all instances of a definition.
+    bool cacheExpressionBinding = true;
+
+    /// The maximum number of errors to report. Once this many have been issued, any further
+    /// errors are counted but not recorded. Zero means no limit.
+    uint32_t errorLimit = 0;
+
+    /// The maximum number of diagnostics to report for any one diagnostic code.
+    /// Zero means no limit.
+    uint32_t maxDiagsPerCode = 0;
+
+    /// If true, elaboration of further instances stops once @a errorLimit has been reached,
+    /// so that badly broken designs fail quickly instead of cascading errors everywhere.
+    bool abortOnErrorLimit = false;
+};
+
+/// Profiling information about calls to a constant function from a particular call site.
+/// Counts and times are inclusive of any nested calls made by the function.
+struct ConstantCallProfile {
+    /// The function that was called.
+    const SubroutineSymbol* subroutine = nullptr;
+
+    /// The location of the call.
+    SourceLocation callLocation;
+
+    /// The number of times the call was evaluated.
+    uint64_t calls = 0;
+
+    /// The total number of expressions evaluated by the calls.
+    uint64_t expressions = 0;
+
+    /// The total number of loop iterations executed by the calls.
+    uint64_t loopIterations = 0;
+
+    /// The total time spent evaluating the calls.
+    std::chrono::nanoseconds time{ 0 };
+};
+
+/// Statistics about the cache of constant function call results.
+struct ConstantFunctionCacheStats {
+    /// The number of calls that were satisfied from the cache.
+    uint64_t hits = 0;
+
+    /// The number of calls that had to be evaluated because no result was cached.
+    uint64_t misses = 0;
+
+    /// The number of results currently stored in the cache.
+    uint64_t entries = 0;
+
+    /// Gets the fraction of lookups that were satisfied from the cache.
+    double hitRate() const {
+        uint64_t total = hits + misses;
+        return total ? double(hits) / double(total) : 0.0;
+    }
+};
+
 /// A centralized location for creating and caching symbols. This includes
 /// creating symbols from syntax nodes as well as fabricating them synthetically.
 /// Common symbols such as built in types are exposed here as well.
 class Compilation : public BumpAllocator {
 public:
-    Compilation();
+    explicit Compilation(const Bag& options = {});
+
+    /// Gets the set of options used to construct the compilation.
+    const CompilationOptions& getOptions() const { return options; }
 
     /// Adds a syntax tree to the compilation. If the compilation has already been finalized
     /// by calling @a getRoot this call will throw an exception.
@@ -52,6 +143,27 @@ public:
     /// Indicates whether the design has been compiled and can no longer accept modifications.
     bool isFinalized() const { return finalized; }
 
+    /// Freezes the compilation so that its packages can be shared with other compilations
+    /// via @a attach. This finalizes the compilation and forces every lazily evaluated member,
+    /// so that nothing in it changes afterward. Typically a frozen compilation contains only
+    /// the packages to be shared; any other design elements are ignored by attachers.
+    void freeze();
+
+    /// Indicates whether the compilation has been frozen via a call to @a freeze.
+    bool isFrozen() const { return frozen; }
+
+    /// Forces every lazily evaluated member in the design to be computed, including any
+    /// that semantic analysis skipped after aborting because of the error limit. After
+    /// this the design can be traversed without modifying it; see @a visitParallel.
+    void forceElaboration();
+
+    /// Attaches a frozen compilation, making its packages visible to lookups in this one
+    /// without having to parse or elaborate them again. The attached compilation is held by
+    /// reference and must outlive this one, and its syntax trees must use the same source
+    /// manager as this compilation's. A single frozen compilation can be attached to any
+    /// number of other compilations in turn.
+    void attach(const Compilation& fragment);
+
     /// Gets the definition with the given name, or null if there is no such definition.
     /// This takes into account the given scope so that nested definitions are found before more
     /// global ones.
@@ -64,6 +176,8 @@ public:
     void addDefinition(const DefinitionSymbol& definition);
 
     /// Gets the package with the give name, or null if there is no such package.
+    /// Packages declared in this compilation are found before those in any
+    /// attached compilations.
     const PackageSymbol* getPackage(string_view name) const;
 
     /// Adds a package to the map of global packages.
@@ -118,6 +232,19 @@ public:
     /// Adds a set of diagnostics to the compilation's list of semantic diagnostics.
     void addDiagnostics(const Diagnostics& diagnostics);
 
+    /// Gets the number of distinct diagnostics issued for each diagnostic code, including
+    /// any that were left out of the reported diagnostics because of the configured limits.
+    flat_hash_map<DiagCode, uint32_t> getDiagnosticCounts();
+
+    /// Returns true if at least @a errorLimit semantic errors have been issued.
+    bool errorLimitReached() const {
+        return options.errorLimit && numErrors >= options.errorLimit;
+    }
+
+    /// Returns true if elaboration is being cut short because the error limit has been
+    /// reached and @a abortOnErrorLimit is set.
+    bool isAborting() const { return options.abortOnErrorLimit && errorLimitReached(); }
+
     /// Gets the default net type that was in place at the time the given declaration was parsed.
     const NetType& getDefaultNetType(const ModuleDeclarationSyntax& decl) const;
 
@@ -163,6 +290,50 @@ public:
 
     /// Allocates a symbol map.
     SymbolMap* allocSymbolMap() { return symbolMapAllocator.emplace(); }
+    SpecializationMap* allocSpecializationMap() { return specializationMapAllocator.emplace(); }
+    GenerateSelectionMap* allocGenerateSelectionMap() { return selectionMapAllocator.emplace(); }
+
+    /// Looks for a previously cached result of calling the given constant function
+    /// with the given argument values. Returns nullptr if there is no such result.
+    /// This only ever finds anything if the @a memoizeConstantFunctions option is set
+    /// and the compilation has not been frozen.
+    const ConstantValue* findConstantCall(const SubroutineSymbol& subroutine,
+                                          span<const ConstantValue> args);
+
+    /// Caches the result of calling the given constant function with the given arguments.
+    /// The caller must ensure that the result depends only on the values of the arguments.
+    /// Frozen compilations don't cache anything further.
+    void cacheConstantCall(const SubroutineSymbol& subroutine, span<const ConstantValue> args,
+                           const ConstantValue& result);
+
+    /// Gets statistics about the usage of the constant function call cache.
+    ConstantFunctionCacheStats getConstantFunctionCacheStats() const;
+
+    /// Looks for a previously bound expression for the given syntax, assignment target type
+    /// (or nullptr for self-determined expressions) and bind flags. Returns nullptr if there
+    /// is no such expression. This only ever finds anything if the @a cacheExpressionBinding
+    /// option is set.
+    const Expression* findBoundExpression(const ExpressionSyntax& syntax, const Type* targetType,
+                                          bitmask<BindFlags> flags) const;
+
+    /// Caches a bound expression for later reuse. The caller must ensure that the result
+    /// doesn't depend on the scope in which the expression was bound.
+    void cacheBoundExpression(const ExpressionSyntax& syntax, const Type* targetType,
+                              bitmask<BindFlags> flags, const Expression& expr);
+
+    /// Gets the total number of semantic diagnostics issued so far, including any that
+    /// were dropped as duplicates or because of the configured limits. This can be used
+    /// to tell whether some operation issued any diagnostics.
+    uint64_t getNumDiagsIssued() const { return numDiagsIssued; }
+
+    /// Records a profiling sample for a constant function call. This is called
+    /// during constant evaluation if the @a profileConstantFunctions option is set.
+    /// Samples recorded after the compilation has been frozen are ignored.
+    void recordConstantCall(const ConstantCallProfile& sample);
+
+    /// Gets all recorded constant function call profiles, one per call site,
+    /// sorted by descending total time.
+    std::vector<ConstantCallProfile> getConstantCallProfile() const;
 
 private:
     // These functions are called by Scopes to create and track various members.
@@ -170,15 +341,40 @@ private:
     Scope::DeferredMemberData& getOrAddDeferredData(Scope::DeferredMemberIndex& index);
     void trackImport(Scope::ImportDataIndex& index, const WildcardImportSymbol& import);
     span<const WildcardImportSymbol*> queryImports(Scope::ImportDataIndex index);
+    Diagnostic& addDiag(const Symbol& source, DiagCode code, SourceLocation location);
 
     bool isFinalizing() const { return finalizing; }
 
+    static size_t hashConstantCall(const SubroutineSymbol& subroutine,
+                                   span<const ConstantValue> args);
+
+    CompilationOptions options;
     Diagnostics diags;
+
+    // Semantic diagnostics are collapsed as they're issued: many instances of the same
+    // definition will report identical problems, and only one copy is ever shown. This maps
+    // the code and location of each issued diagnostic to its index in the diags list.
+    flat_hash_map<std::tuple<DiagCode, SourceLocation>, size_t> diagMap;
+
+    // The number of distinct semantic diagnostics issued for each code, and the number of
+    // those that were errors, used to enforce the configured diagnostic limits.
+    flat_hash_map<DiagCode, uint32_t> diagCounts;
+    uint32_t numErrors = 0;
+    uint64_t numDiagsIssued = 0;
+
+    // Handed back to callers issuing diagnostics that have already been dropped, so that
+    // they can still attach arguments and notes.
+    Diagnostic discardedDiag{ DiagCode(), SourceLocation() };
     std::unique_ptr<RootSymbol> root;
     CompilationUnitSymbol* emptyUnit = nullptr;
     const SourceManager* sourceManager = nullptr;
     bool finalized = false;
     bool finalizing = false; // to prevent reentrant calls to getRoot()
+    bool frozen = false;
+    bool forced = false;
+
+    // Frozen compilations whose packages are visible in this one, in the order attached.
+    std::vector<const Compilation*> attachedFragments;
 
     optional<Diagnostics> cachedParseDiagnostics;
     optional<Diagnostics> cachedSemanticDiagnostics;
@@ -192,6 +388,8 @@ private:
 
     // Specialized allocators for types that are not trivially destructible.
     TypedBumpAllocator<SymbolMap> symbolMapAllocator;
+    TypedBumpAllocator<SpecializationMap> specializationMapAllocator;
+    TypedBumpAllocator<GenerateSelectionMap> selectionMapAllocator;
     TypedBumpAllocator<ConstantValue> constantAllocator;
 
     // Sideband data for scopes that have deferred members.
@@ -233,6 +431,24 @@ private:
     // Map from symbols to their associated attributes.
     flat_hash_map<const Symbol*, std::vector<const AttributeSymbol*>> symbolAttributes;
 
+    // Cached results of constant function calls, keyed by a hash of the subroutine and
+    // argument values. Each bucket holds all entries that share the same hash.
+    struct CachedCall {
+        const SubroutineSymbol* subroutine;
+        std::vector<ConstantValue> args;
+        ConstantValue result;
+    };
+    flat_hash_map<size_t, std::vector<CachedCall>> constantCallCache;
+    ConstantFunctionCacheStats constantCallStats;
+
+    // Profiling information for constant function calls, keyed by function and call site.
+    flat_hash_map<std::tuple<const SubroutineSymbol*, SourceLocation>, ConstantCallProfile>
+        constantCallProfiles;
+
+    // Cache of bound expressions that are independent of the scope they were bound in.
+    flat_hash_map<std::tuple<const ExpressionSyntax*, const Type*, uint8_t>, const Expression*>
+        boundExpressionCache;
+
     // A table to look up scalar types based on combinations of the three flags: signed, fourstate,
     // reg Two of the entries are not valid and will be nullptr (!fourstate & reg).
     ScalarType* scalarTypeTable[8]{ nullptr };
@@ -0,0 +1,118 @@
+//------------------------------------------------------------------------------
+// ConnectivityGraph.h
+// Design-wide graph of value drivers and loads.
+//
+// File is under the MIT license; see LICENSE for details.
+//------------------------------------------------------------------------------
+#pragma once
+
+#include <flat_hash_map.hpp>
+#include <iosfwd>
+#include <vector>
+
+#include "slang/binding/ConstantValue.h"
+#include "slang/symbols/Symbol.h"
+
+namespace slang {
+
+class RootSymbol;
+
+/// A flattened graph of the connections between the nets, variables, and ports of an
+/// elaborated design. Each node is a value symbol, and each edge records that one value
+/// drives another, either through a continuous assignment or a port connection.
+///
+/// Edges are stored in compressed sparse row form: the edges driving a node are contiguous,
+/// and a second offset table indexes the edges loaded from each node, so both drivers and
+/// loads of any node can be found in constant time without any per-node allocations.
+///
+/// Each edge also records which part of the source and target values it covers, as a range
+/// in terms of the value's outermost declared dimension. Selects with constant bounds narrow
+/// the range to the selected bits or elements; anything else covers the whole value.
+/// Constant drivers and procedural assignments are not represented.
+class ConnectivityGraph {
+public:
+    enum class EdgeKind : uint8_t { Assign, Port };
+
+    struct Edge {
+        /// The node for the value doing the driving.
+        uint32_t source;
+
+        /// The node for the value being driven.
+        uint32_t target;
+
+        /// The part of the source value that is read, normalized so that left >= right.
+        ConstantRange sourceRange;
+
+        /// The part of the target value that is driven, normalized so that left >= right.
+        ConstantRange targetRange;
+
+        /// The construct that created the connection.
+        EdgeKind kind;
+    };
+
+    /// Builds the graph for every instance beneath the given root. The expressions
+    /// making up the connections are scanned using the given number of threads.
+    static ConnectivityGraph build(const RootSymbol& root, uint32_t numThreads = 1);
+
+    /// Reads a graph previously written with save(). Graphs loaded this way have
+    /// no associated symbols, but all other information is preserved. Throws an
+    /// exception if the data is malformed.
+    static ConnectivityGraph load(std::istream& stream);
+
+    /// Writes the graph out in a compact binary form.
+    void save(std::ostream& stream) const;
+
+    /// The number of nodes in the graph.
+    size_t numNodes() const { return kinds.size(); }
+
+    /// Gets all edges in the graph, grouped by target node.
+    span<const Edge> edges() const { return edges_; }
+
+    /// Gets the full hierarchical path of the value represented by the given node.
+    string_view getPath(uint32_t node) const;
+
+    /// Gets the kind of the symbol represented by the given node.
+    SymbolKind getKind(uint32_t node) const { return kinds[node]; }
+
+    /// Gets the symbol represented by the given node, or nullptr if the graph was
+    /// loaded from disk.
+    const ValueSymbol* getSymbol(uint32_t node) const {
+        return symbols.empty() ? nullptr : symbols[node];
+    }
+
+    /// Finds the node for the given symbol, if it's part of the graph.
+    optional<uint32_t> findNode(const ValueSymbol& symbol) const;
+
+    /// Finds the node with the given hierarchical path, if it's part of the graph.
+    optional<uint32_t> findNode(string_view path) const;
+
+    /// Gets the edges that drive the given node.
+    span<const Edge> getDrivers(uint32_t node) const;
+
+    /// Gets the indices of the edges that load from the given node.
+    span<const uint32_t> getLoads(uint32_t node) const;
+
+private:
+    class Builder;
+
+    uint32_t addNode(const ValueSymbol* symbol, SymbolKind kind, string_view path);
+    void finalize();
+
+    std::vector<const ValueSymbol*> symbols;
+    std::vector<SymbolKind> kinds;
+
+    // Paths for all nodes are stored back to back, with node i's
+    // path ending where node i + 1's begins.
+    std::string pathData;
+    std::vector<uint32_t> pathOffsets{ 0 };
+
+    std::vector<Edge> edges_;
+    std::vector<uint32_t> driverOffsets;
+    std::vector<uint32_t> loadEdges;
+    std::vector<uint32_t> loadOffsets;
+
+    flat_hash_map<const ValueSymbol*, uint32_t> symbolMap;
+    flat_hash_map<string_view, uint32_t> pathMap;
+};
+
+} // namespace slang
@@ -0,0 +1,125 @@
+//------------------------------------------------------------------------------
+// HierarchyIndex.h
+// Index of full hierarchical paths in an elaborated design.
+//
+// File is under the MIT license; see LICENSE for details.
+//------------------------------------------------------------------------------
+#pragma once
+
+#include <iosfwd>
+#include <vector>
+
+#include "slang/symbols/Symbol.h"
+#include "slang/util/SmallVector.h"
+
+namespace slang {
+
+class RootSymbol;
+
+/// An index of every instance, generate block, and named member of those scopes in an
+/// elaborated design, keyed by full hierarchical path (for example "top.u1.gen[2].sig").
+/// Once built, lookups are a single hash probe and don't touch the symbol tree at all.
+///
+/// Entries are kept sorted by path, so all paths sharing a prefix form a contiguous range,
+/// which makes prefix and glob queries cheap. The whole index lives in one flat, position
+/// independent block of memory that can be written to disk as-is; other processes can map
+/// the file into memory and query it through fromBuffer() without any parsing or copying.
+class HierarchyIndex {
+public:
+    HierarchyIndex(const HierarchyIndex&) = delete;
+    HierarchyIndex(HierarchyIndex&&) = default;
+    HierarchyIndex& operator=(HierarchyIndex&&) = default;
+
+    /// Builds an index of everything beneath the given root.
+    static HierarchyIndex build(const RootSymbol& root);
+
+    /// Reads an index previously written with save(). Throws an exception if the
+    /// data is malformed.
+    static HierarchyIndex load(std::istream& stream);
+
+    /// Creates an index that refers directly to an image previously written with save(),
+    /// for example one that has been mapped into memory. The data is not copied, so it
+    /// must outlive the index, and it must be aligned to at least 8 bytes. Throws an
+    /// exception if the data is malformed.
+    static HierarchyIndex fromBuffer(span<const char> data);
+
+    /// Writes the index out. The written image is identical to the in-memory form.
+    void save(std::ostream& stream) const;
+
+    /// The number of entries in the index.
+    uint32_t size() const { return header().numEntries; }
+
+    /// Finds the entry with the given full path.
+    optional<uint32_t> find(string_view path) const;
+
+    /// Finds the entries for a batch of paths. Each result is the entry index for the
+    /// corresponding path, or nullopt if the path isn't in the index.
+    void find(span<const string_view> paths, SmallVector<optional<uint32_t>>& results) const;
+
+    /// Gets the range of entries whose paths start with the given text, as a pair of
+    /// [begin, end) entry indices. Note that this is a plain textual prefix; to get just
+    /// the members of a scope, include the trailing '.' in the prefix.
+    std::pair<uint32_t, uint32_t> findPrefix(string_view prefix) const;
+
+    /// Finds all entries whose paths match the given pattern, in path order. A '?' in the
+    /// pattern matches any one character, a '*' matches any sequence of characters within
+    /// a single path component, and a '**' matches any sequence of characters at all.
+    void glob(string_view pattern, SmallVector<uint32_t>& results) const;
+
+    /// Gets the full path of the given entry.
+    string_view getPath(uint32_t entry) const;
+
+    /// Gets the kind of the symbol for the given entry.
+    SymbolKind getKind(uint32_t entry) const { return SymbolKind(entries()[entry].kind); }
+
+    /// Gets the entry for the scope containing the given entry, if it's in the index.
+    optional<uint32_t> getParent(uint32_t entry) const;
+
+    /// Gets the symbol for the given entry, or nullptr if the index was not built
+    /// in this process.
+    const Symbol* getSymbol(uint32_t entry) const {
+        return symbols.empty() ? nullptr : symbols[entry];
+    }
+
+private:
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t numEntries;
+        uint32_t numBuckets;
+        uint32_t stringDataSize;
+    };
+
+    struct Entry {
+        uint64_t hash;
+        uint32_t pathOffset;
+        uint32_t pathLength;
+        uint32_t kind;
+        uint32_t parent;
+    };
+
+    static constexpr uint32_t NoEntry = UINT32_MAX;
+
+    HierarchyIndex() = default;
+
+    void setData(span<const char> newData);
+
+    const Header& header() const { return *reinterpret_cast<const Header*>(data.data()); }
+    const Entry* entries() const {
+        return reinterpret_cast<const Entry*>(data.data() + sizeof(Header));
+    }
+    const uint32_t* buckets() const {
+        return reinterpret_cast<const uint32_t*>(entries() + header().numEntries);
+    }
+    const char* stringData() const {
+        return reinterpret_cast<const char*>(buckets() + header().numBuckets);
+    }
+
+    // The image; either points into ownedData or into memory owned by the caller.
+    span<const char> data;
+    std::vector<uint64_t> ownedData;
+
+    std::vector<const Symbol*> symbols;
+};
+
+} // namespace slang
@@ -7,6 +7,7 @@
 #pragma once
 
 #include <flat_hash_map.hpp>
+#include <vector>
 
 #include "slang/symbols/HierarchySymbols.h"
 #include "slang/symbols/MemberSymbols.h"
@@ -17,6 +18,22 @@ namespace slang {
 
 class SemanticModel {
 public:
+    /// A span of source text that names a symbol, as recorded by indexCompilationUnit().
+    struct SymbolSpan {
+        /// The offset of the first character of the span within its source buffer.
+        uint32_t start;
+
+        /// The offset just past the last character of the span.
+        uint32_t end;
+
+        /// The named symbol. For references, this is the symbol being referred to.
+        const Symbol* symbol;
+
+        /// Whether the span is the name in the symbol's declaration, as opposed to
+        /// a reference to it from somewhere else.
+        bool isDeclaration;
+    };
+
     explicit SemanticModel(Compilation& compilation);
 
     void withContext(const SyntaxNode& node, const Symbol& symbol);
@@ -34,10 +51,37 @@ public:
     const EnumType* getDeclaredSymbol(const EnumTypeSyntax& syntax);
     const TypeAliasType* getDeclaredSymbol(const TypedefDeclarationSyntax& syntax);
 
+    /// Indexes every declaration in the given compilation unit, along with every reference
+    /// to a value, subroutine, type alias, or definition, in a single pass over its symbols.
+    /// The syntax nodes of all declarations are added to the cache used by getDeclaredSymbol,
+    /// and the names of all declarations and references can then be found by source location
+    /// through findSpan(). Anything that was expanded from a macro is not indexed.
+    void indexCompilationUnit(const CompilationUnitSyntax& syntax);
+
+    /// Finds the innermost indexed span covering the given location, or nullptr if there
+    /// isn't one (or the containing compilation unit hasn't been indexed).
+    const SymbolSpan* findSpan(SourceLocation location) const;
+
+    /// Gets the symbol named at the given location, or nullptr if there isn't one. For
+    /// references, this is the declared symbol being referred to.
+    const Symbol* getSymbolAt(SourceLocation location) const;
+
+    /// Gets all indexed spans in the given source buffer, sorted by starting offset.
+    span<const SymbolSpan> getSpans(BufferID buffer) const;
+
 private:
+    // Spans are sorted by start offset, with enclosing spans ordered before the spans
+    // they contain. maxEnds[i] is the largest end offset of any of spans[0..i], which
+    // lets a query stop as soon as no earlier span can reach the queried offset.
+    struct FileIndex {
+        std::vector<SymbolSpan> spans;
+        std::vector<uint32_t> maxEnds;
+    };
+
     Compilation& compilation;
 
     flat_hash_map<const SyntaxNode*, const Symbol*> symbolCache;
+    flat_hash_map<BufferID, FileIndex> fileIndices;
 };
 
 } // namespace slang
\ No newline at end of file
@@ -6,7 +6,9 @@
 //------------------------------------------------------------------------------
 #pragma once
 
-#include <deque>
+#include <flat_hash_map.hpp>
+#include <functional>
+#include <mutex>
 
 #include "slang/diagnostics/Diagnostics.h"
 
@@ -18,8 +20,14 @@ class SourceManager;
 /// it can be configured on a per-diagnostic basis at runtime.
 enum class DiagnosticSeverity { Note, Warning, Error };
 
+/// Renders diagnostics as human-readable text, with source snippets and include stacks.
+/// Writers are not copyable or movable, since they hold a mutex that guards the include
+/// stack cache shared by the threads rendering a parallel report.
 class DiagnosticWriter {
 public:
+    /// A callback that receives rendered diagnostic text, in order.
+    using Sink = std::function<void(std::string&&)>;
+
     explicit DiagnosticWriter(const SourceManager& sourceManager);
 
     /// Writes a report for the given diagnostic.
@@ -28,9 +36,17 @@ public:
     /// Writes a report for all of the diagnostics in the given collection.
     std::string report(const Diagnostics& diagnostics);
 
+    /// Writes a report for all of the diagnostics in the given collection, handing
+    /// the text to @a sink a chunk at a time instead of building up the whole report
+    /// in memory. If @a numThreads is greater than one, chunks are rendered in parallel;
+    /// the sink is always invoked from the calling thread, in diagnostic order.
+    void report(const Diagnostics& diagnostics, const Sink& sink, uint32_t numThreads = 1);
+
 private:
+    void reportChunk(span<const Diagnostic> diagnostics, BufferID lastBuffer,
+                     std::string& result);
     string_view getBufferLine(SourceLocation location, uint32_t col);
-    void getIncludeStack(BufferID buffer, std::deque<SourceLocation>& stack);
+    std::string getIncludeStack(BufferID buffer);
     void highlightRange(SourceRange range, SourceLocation caretLoc, uint32_t col,
                         string_view sourceLine, std::string& buffer);
 
@@ -39,6 +55,10 @@ private:
                     const char* severity, const std::string& msg);
 
     const SourceManager& sourceManager;
+
+    // Rendered "included from" text for each buffer we've reported on so far.
+    flat_hash_map<BufferID, std::string> includeStackCache;
+    std::mutex includeStackMutex;
 };
 
 } // namespace slang
\ No newline at end of file
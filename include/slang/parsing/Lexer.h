@@ -23,6 +23,13 @@ struct LexerOptions {
     /// The maximum number of errors that can occur before the rest of the source
     /// buffer is skipped.
     uint32_t maxErrors = 16;
+
+    /// If set to true, whitespace and comment trivia is dropped instead of being attached
+    /// to tokens. This saves a good deal of memory when the resulting syntax tree will not
+    /// be printed back out. Line endings, as well as all trivia on lines that contain
+    /// preprocessor directives or macro usages, are always kept because the preprocessor
+    /// relies on them.
+    bool discardTrivia = false;
 };
 
 /// The Lexer is responsible for taking source text and chopping it up into tokens.
@@ -36,6 +43,13 @@ public:
     Lexer(SourceBuffer buffer, BumpAllocator& alloc, Diagnostics& diagnostics,
           LexerOptions options = LexerOptions{});
 
+    /// Constructs a lexer that covers only the portion of @a buffer between @a startOffset
+    /// and @a endOffset. Token locations are still relative to the start of the full buffer.
+    /// Once the end of the range is reached, only EndOfFile tokens are produced; the end
+    /// offset should fall just past the end of a token.
+    Lexer(SourceBuffer buffer, size_t startOffset, size_t endOffset, BumpAllocator& alloc,
+          Diagnostics& diagnostics, LexerOptions options = LexerOptions{});
+
     // Not copyable
     Lexer(const Lexer&) = delete;
     Lexer& operator=(const Lexer&) = delete;
@@ -45,6 +59,14 @@ public:
     /// an infinite stream of EndOfFile tokens will be generated
     Token lex(KeywordVersion keywordVersion = getDefaultKeywordVersion());
 
+    /// Skips over source text that has been disabled by a conditional directive, up to
+    /// the next `ifdef, `ifndef, `elsif, `else or `endif directive or the end of the buffer.
+    /// The text is scanned without being tokenized; comments, string literals and escaped
+    /// identifiers are skipped as a whole so that directives within them are ignored.
+    /// All of the skipped text is attached as a single DisabledText trivia to the next
+    /// lexed token.
+    void skipDisabledText();
+
     BufferID getBufferID() const;
     BumpAllocator& getAllocator() { return alloc; }
     Diagnostics& getDiagnostics() { return diagnostics; }
@@ -90,6 +112,7 @@ private:
     bool scanExponent(uint64_t& value, bool& negative);
 
     void addTrivia(TriviaKind kind, SmallVector<Trivia>& triviaBuffer);
+    void addEndOfLine(SmallVector<Trivia>& triviaBuffer);
     void addDiag(DiagCode code, uint32_t offset);
 
     // source pointer manipulation
@@ -128,12 +151,24 @@ private:
     // save our place in the buffer to measure out the current lexeme
     const char* marker;
 
+    // if lexing only part of the buffer, the point at which to stop
+    const char* rangeEnd = nullptr;
+
     // the number of errors that have occurred while lexing the current buffer
     uint32_t errorCount = 0;
 
+    // text skipped by skipDisabledText that has yet to be attached to a token
+    string_view disabledText;
+
     // Keeps track of whether we just entered a new line, to enforce tokens
     // that must start on their own line
     bool onNewLine = true;
+
+    // When discarding trivia, tracks whether the current line contains a directive
+    // (and therefore needs its trivia kept), along with how deeply nested we are in
+    // parentheses for macro arguments that span multiple lines.
+    bool inDirectiveLine = false;
+    uint32_t directiveParenDepth = 0;
 };
 
 } // namespace slang
@@ -44,6 +44,12 @@ struct ParserOptions {
     /// The maximum depth of nested language constructs (statements, exceptions) before
     /// we give up for fear of stack overflow.
     uint32_t maxRecursionDepth = 1024;
+
+    /// The number of threads to use when building a syntax tree for a single large
+    /// source buffer. If greater than one, buffers that contain no preprocessor
+    /// directives are split at top-level `endmodule` boundaries and the pieces are
+    /// parsed concurrently. The resulting tree is the same as from a serial parse.
+    uint32_t numThreads = 1;
 };
 
 /// Implements a full syntax parser for SystemVerilog.
@@ -41,14 +41,18 @@ protected:
     Preprocessor& getPP() { return window.tokenSource; }
 
     /// Helper class that maintains a sliding window of tokens, with lookahead.
+    /// Tokens are kept in a ring buffer whose capacity is always a power of two,
+    /// so advancing the window never needs to shift tokens around. The buffer
+    /// starts out in inline storage and only moves to the heap if some construct
+    /// requires more lookahead than that.
     class Window {
     public:
-        explicit Window(Preprocessor& source) : tokenSource(source) {
-            capacity = 32;
-            buffer = new Token[capacity];
-        }
+        explicit Window(Preprocessor& source) : tokenSource(source) {}
 
-        ~Window() { delete[] buffer; }
+        ~Window() {
+            if (buffer != inlineBuffer)
+                delete[] buffer;
+        }
 
         // not copyable
         Window(const Window&) = delete;
@@ -57,22 +61,30 @@ protected:
         // the source of all tokens
         Preprocessor& tokenSource;
 
-        // a buffer of tokens for implementing lookahead
-        Token* buffer = nullptr;
-
         // the current token we're looking at
         Token currentToken;
 
         // the last token we consumed
         Token lastConsumed;
 
-        // the current offset within the lookahead buffer
-        uint32_t currentOffset = 0;
+        // the number of tokens buffered, starting at the current token
         uint32_t count = 0;
-        uint32_t capacity = 0;
+
+        Token& at(uint32_t offset) { return buffer[(head + offset) & (capacity - 1)]; }
 
         void addNew();
         void moveToNext();
+
+    private:
+        static constexpr uint32_t InlineCapacity = 32;
+
+        // a buffer of tokens for implementing lookahead
+        Token inlineBuffer[InlineCapacity];
+        Token* buffer = inlineBuffer;
+        uint32_t capacity = InlineCapacity;
+
+        // the index in the buffer of the current token
+        uint32_t head = 0;
     };
 
     BumpAllocator& alloc;
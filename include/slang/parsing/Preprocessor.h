@@ -7,7 +7,7 @@
 #pragma once
 
 #include <deque>
-#include <unordered_map>
+#include <memory>
 
 #include "slang/diagnostics/Diagnostics.h"
 #include "slang/parsing/Lexer.h"
@@ -60,6 +60,10 @@ public:
     void pushSource(string_view source);
     void pushSource(SourceBuffer buffer);
 
+    /// Push just a portion of a source file onto the stack, from @a startOffset up
+    /// to @a endOffset. See the Lexer's range constructor for details.
+    void pushSource(SourceBuffer buffer, size_t startOffset, size_t endOffset);
+
     /// Predefines the given macro definition. The given definition string is lexed
     /// as if it were source text immediately following a `define directive.
     /// If any diagnostics are printed for the created text, they will be marked
@@ -78,6 +82,20 @@ public:
     /// directives except for the intrinsic macros (__LINE__, etc).
     bool isDefined(string_view name);
 
+    class MacroSnapshot;
+
+    /// Captures the set of currently defined macros. Taking a snapshot doesn't copy
+    /// any definitions; the current definitions are frozen and shared between the
+    /// snapshot and this preprocessor, which keeps any later changes separately.
+    ///
+    /// Macro definitions refer to syntax nodes owned by the allocator passed to the
+    /// preprocessor that parsed them, so that allocator must outlive the snapshot.
+    MacroSnapshot getMacroSnapshot();
+
+    /// Replaces all currently defined macros with the ones from the given snapshot,
+    /// e.g. to continue a compilation unit that was started by another preprocessor.
+    void setMacros(const MacroSnapshot& snapshot);
+
     /// Sets the base keyword version for the current compilation unit. Note that this does not
     /// affect the keyword version if the user has explicitly requested a different
     /// version via the begin_keywords directive.
@@ -154,6 +172,37 @@ private:
         bool needsArgs() const;
     };
 
+    // Maps macro names to definitions. An invalid definition marks a macro that has
+    // been undefined, hiding any definition in an older layer.
+    using MacroMap = flat_hash_map<string_view, MacroDef>;
+
+    // The number of snapshot layers after which they get flattened into one.
+    static constexpr uint32_t MaxMacroLayers = 8;
+
+    // A frozen set of macro definitions, layered on top of older ones.
+    struct MacroLayer {
+        std::shared_ptr<const MacroLayer> parent;
+        MacroMap macros;
+        uint32_t depth = 0;
+    };
+
+public:
+    /// An immutable set of macro definitions captured from a preprocessor.
+    /// See @a getMacroSnapshot for details.
+    class MacroSnapshot {
+    public:
+        MacroSnapshot() = default;
+
+    private:
+        friend class Preprocessor;
+        explicit MacroSnapshot(std::shared_ptr<const MacroLayer> layer) :
+            layer(std::move(layer)) {}
+
+        std::shared_ptr<const MacroLayer> layer;
+    };
+
+private:
+
     // Helper class for tracking state used during expansion of a macro.
     class MacroExpansion {
     public:
@@ -166,20 +215,35 @@ private:
 
         void append(Token token, SourceLocation location);
 
+        // Whether any of the appended tokens are nested macro usages or macro operators
+        // that require another pass over the expanded tokens.
+        bool needsRescan() const { return rescan; }
+
     private:
         BumpAllocator& alloc;
         SmallVector<Token>& dest;
         Token usageSite;
         bool any = false;
         bool isTopLevel = false;
+        bool rescan = false;
+    };
+
+    // Pre-analyzed form of a macro body that lets expansions avoid looking up
+    // formal argument names for every body token.
+    struct MacroTemplate {
+        // For each token in the body, the index of the formal argument that it
+        // should be replaced with, or -1 if the token is copied as-is.
+        span<const int32_t> argSlots;
     };
 
     // Macro handling methods
     MacroDef findMacro(Token directive);
+    MacroDef findMacro(string_view name) const;
     MacroActualArgumentListSyntax* handleTopLevelMacro(Token directive);
     bool expandMacro(MacroDef macro, MacroExpansion& expansion,
                      MacroActualArgumentListSyntax* actualArgs);
     bool expandIntrinsic(MacroIntrinsic intrinsic, MacroExpansion& expansion);
+    const MacroTemplate& getMacroTemplate(const DefineDirectiveSyntax& directive);
     bool expandReplacementList(span<Token const>& tokens,
                                SmallSet<DefineDirectiveSyntax*, 8>& alreadyExpanded);
     bool applyMacroOps(span<Token const> tokens, SmallVector<Token>& dest);
@@ -259,8 +323,13 @@ private:
     // keep track of nested processor branches (ifdef, ifndef, else, elsif, endif)
     std::deque<BranchEntry> branchStack;
 
-    // map from macro name to macro definition
-    std::unordered_map<string_view, MacroDef> macros;
+    // map from macro name to macro definition; only holds changes made since the
+    // last snapshot, with everything older living in the shared base layers
+    MacroMap macros;
+    std::shared_ptr<const MacroLayer> macroBase;
+
+    // lazily built templates for macros that take arguments
+    flat_hash_map<const DefineDirectiveSyntax*, const MacroTemplate*> macroTemplates;
 
     // list of expanded macro tokens to drain before continuing with active lexer
     SmallVectorSized<Token, 16> expandedTokens;
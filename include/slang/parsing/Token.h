@@ -128,12 +128,6 @@ class Token {
 public:
     /// Heap-allocated info block.
     struct Info {
-        /// Numeric-related information.
-        struct NumericLiteralInfo {
-            std::variant<logic_t, double, SVIntStorage> value;
-            NumericTokenFlags numericFlags;
-        };
-
         /// Leading trivia.
         span<slang::Trivia const> trivia;
 
@@ -148,12 +142,18 @@ public:
         /// string_view: The nice text of a string literal.
         /// SyntaxKind: The kind of a directive token.
         /// IdentifierType: The kind of an identifer token.
-        /// NumericLiteralInfo: Info for numeric tokens.
-        std::variant<string_view, SyntaxKind, IdentifierType, NumericLiteralInfo> extra;
+        /// logic_t, double, SVIntStorage: The value of a numeric token.
+        /// This is kept flat (instead of nesting numeric info in its own struct)
+        /// so that the variant, and therefore every info block, stays small.
+        std::variant<string_view, SyntaxKind, IdentifierType, logic_t, double, SVIntStorage> extra;
 
         /// Various token flags.
         bitmask<TokenFlags> flags;
 
+        /// Flags for numeric tokens; stored here so they can share padding with
+        /// the general token flags.
+        NumericTokenFlags numFlags;
+
         Info() = default;
         Info(span<Trivia const> trivia, string_view rawText, SourceLocation location,
              bitmask<TokenFlags> flags = TokenFlags::None);
@@ -167,7 +167,6 @@ public:
         const string_view& stringText() const { return std::get<string_view>(extra); }
         const SyntaxKind& directiveKind() const { return std::get<SyntaxKind>(extra); }
         const IdentifierType& idType() const { return std::get<IdentifierType>(extra); }
-        const NumericLiteralInfo& numInfo() const { return std::get<NumericLiteralInfo>(extra); }
     };
 
     /// The kind of the token; this is not in the info block because
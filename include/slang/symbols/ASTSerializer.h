@@ -0,0 +1,125 @@
+//------------------------------------------------------------------------------
+// ASTSerializer.h
+// Streaming serialization of the AST.
+//
+// File is under the MIT license; see LICENSE for details.
+//------------------------------------------------------------------------------
+#pragma once
+
+#include <deque>
+#include <flat_hash_map.hpp>
+#include <iosfwd>
+
+#include "slang/symbols/ASTVisitor.h"
+#include "slang/util/SmallVector.h"
+
+namespace slang {
+
+/// Writes out a symbol hierarchy directly to an output stream, without ever building
+/// up a document for the whole thing in memory. Each symbol's own properties are
+/// serialized the same way as with to_json(), and then the members of scopes are
+/// visited and written out one at a time.
+///
+/// Two formats are supported: JSON, which is equivalent to the output of to_json(), and
+/// a compact binary format that can be read back with BinaryASTReader.
+class ASTSerializer : public ASTVisitor<ASTSerializer> {
+public:
+    enum class Format { Json, Binary };
+
+    ASTSerializer(std::ostream& stream, Format format);
+
+    /// Writes out the given symbol and everything beneath it.
+    void serialize(const Symbol& symbol);
+
+    template<typename T>
+    void handle(const T& elem) {
+        if constexpr (std::is_base_of_v<Type, T> && !std::is_same_v<TypeAliasType, T>) {
+            writeType(elem);
+        }
+        else if constexpr (std::is_base_of_v<Symbol, T>) {
+            startSymbol(elem);
+            if constexpr (std::is_base_of_v<Scope, T>) {
+                for (const auto& member : elem.members())
+                    member.visit(*this);
+            }
+            endSymbol();
+        }
+    }
+
+private:
+    void startSymbol(const Symbol& symbol);
+    void endSymbol();
+    void writeType(const Type& type);
+    void startMember();
+
+    uint32_t getStringId(string_view str);
+    void writeRecord(uint8_t tag, const std::string& payload);
+
+    std::ostream& stream;
+    Format format;
+
+    // For JSON output, tracks whether each symbol currently being written has
+    // had its members list opened yet.
+    SmallVectorSized<bool, 16> membersOpen;
+
+    // For binary output, the strings that have already been written out.
+    flat_hash_map<std::string, uint32_t> stringTable;
+};
+
+/// Reads back the binary format written by ASTSerializer, one record at a time.
+/// Only the string table is retained between records, so arbitrarily large files
+/// can be processed with a small amount of memory.
+class BinaryASTReader {
+public:
+    enum class RecordKind {
+        /// The start of a symbol; the symbol's members follow, up until the
+        /// matching EndSymbol record.
+        BeginSymbol,
+
+        /// The end of the most recently started symbol.
+        EndSymbol,
+
+        /// A type appearing as a member of a scope. Only its textual
+        /// representation is recorded.
+        Type
+    };
+
+    struct Record {
+        RecordKind kind;
+
+        /// The name of the symbol, or the text of the type for Type records.
+        string_view name;
+
+        /// The kind of the symbol, as a string.
+        string_view symbolKind;
+
+        /// The address of the symbol in the program that wrote out the file;
+        /// this matches the targets of links between symbols.
+        uint64_t address = 0;
+
+        /// Decodes and returns the remaining properties of the symbol.
+        json getProperties() const;
+
+    private:
+        friend class BinaryASTReader;
+        std::string propertyData;
+    };
+
+    /// Creates a reader over the given stream. Throws an exception if the
+    /// stream does not start with a valid header.
+    explicit BinaryASTReader(std::istream& stream);
+
+    /// Reads the next record from the stream. Returns false once the end of the
+    /// stream has been reached. Throws an exception if the data is malformed.
+    bool next(Record& record);
+
+    /// Reads all remaining records and assembles them into a single JSON document,
+    /// in the same form that to_json() would produce.
+    json readAll();
+
+private:
+    std::istream& stream;
+    std::deque<std::string> strings;
+};
+
+} // namespace slang
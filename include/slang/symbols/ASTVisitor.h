@@ -6,25 +6,79 @@
 //------------------------------------------------------------------------------
 #pragma once
 
+#include <bitset>
+#include <thread>
+
 #include "slang/binding/Expressions.h"
 #include "slang/binding/Statements.h"
+#include "slang/compilation/Compilation.h"
 #include "slang/symbols/HierarchySymbols.h"
 #include "slang/symbols/MemberSymbols.h"
 #include "slang/symbols/TypeSymbols.h"
 
 namespace slang {
 
+/// Flags that control which parts of the AST are traversed by an ASTVisitor.
+enum class VisitFlags : uint8_t {
+    None = 0,
+
+    /// Visit the bodies of procedural blocks and subroutines. Note that this forces
+    /// the statements within them to be bound.
+    Statements = 1,
+
+    /// Visit generate blocks that were not instantiated.
+    UninstantiatedBlocks = 2,
+
+    /// Resolve the declared type and initializer of each symbol before handling it,
+    /// instead of leaving them to be resolved lazily when first requested.
+    ResolveTypes = 4
+};
+BITMASK_DEFINE_MAX_ELEMENT(VisitFlags, ResolveTypes);
+
+/// A set of symbol kinds, used to filter the symbols an ASTVisitor handles.
+using SymbolKindSet = std::bitset<SymbolKindCount>;
+
 /// Use this type as a base class for AST visitors. It will default to
 /// traversing all children of each node. Add implementations for any specific
 /// node types you want to handle.
+///
+/// The derived class can also provide a `bool shouldVisit(const Symbol&)` method;
+/// returning false from it skips the given symbol and everything beneath it.
 template<typename TDerived>
 class ASTVisitor {
     HAS_METHOD_TRAIT(handle);
+    HAS_METHOD_TRAIT(shouldVisit);
 
 public:
+    /// Controls which parts of the AST are traversed.
+    bitmask<VisitFlags> visitFlags = VisitFlags::Statements | VisitFlags::UninstantiatedBlocks;
+
+    /// Symbols with kinds that aren't in this set are still traversed, but they aren't
+    /// passed to any handle() methods. By default every kind is handled.
+    SymbolKindSet handledKinds = SymbolKindSet().set();
+
+    /// Symbols with kinds in this set are skipped, along with everything beneath them.
+    SymbolKindSet prunedKinds;
+
 #define DERIVED *static_cast<TDerived*>(this)
     template<typename T>
     void visit(const T& t) {
+        if constexpr (std::is_base_of_v<Symbol, T>) {
+            // When visiting in parallel, each instance is visited on its own.
+            if constexpr (std::is_base_of_v<InstanceSymbol, T>) {
+                if (splitAtInstances && &t != currentUnit)
+                    return;
+            }
+
+            if (&t != currentUnit && !shouldEnter(t))
+                return;
+
+            if (!handledKinds.test(size_t(t.kind))) {
+                visitDefault(t);
+                return;
+            }
+        }
+
         if constexpr (has_handle_v<TDerived, void, T>)
             static_cast<TDerived*>(this)->handle(t);
         else
@@ -41,15 +95,138 @@ public:
             member.visit(DERIVED);
 
         if constexpr (std::is_base_of_v<StatementBodiedScope, T>) {
-            auto body = symbol.getBody();
-            if (body)
-                body->visit(DERIVED);
+            if (visitFlags & VisitFlags::Statements) {
+                auto body = symbol.getBody();
+                if (body)
+                    body->visit(DERIVED);
+            }
+        }
+    }
+
+    /// Determines whether the given symbol passes all of the filters set on this
+    /// visitor and should be visited.
+    bool shouldEnter(const Symbol& symbol) {
+        if (prunedKinds.test(size_t(symbol.kind)))
+            return false;
+
+        if (symbol.kind == SymbolKind::GenerateBlock &&
+            !(visitFlags & VisitFlags::UninstantiatedBlocks) &&
+            !symbol.as<GenerateBlockSymbol>().isInstantiated) {
+            return false;
+        }
+
+        if constexpr (has_shouldVisit_v<TDerived, bool, const Symbol&>) {
+            if (!static_cast<TDerived*>(this)->shouldVisit(symbol))
+                return false;
+        }
+
+        if (visitFlags & VisitFlags::ResolveTypes) {
+            if (auto declaredType = symbol.getDeclaredType()) {
+                declaredType->getType();
+                declaredType->getInitializer();
+            }
         }
+        return true;
     }
 
 #undef DERIVED
+
+private:
+    template<typename TVisitor>
+    friend void visitParallel(Compilation& compilation, TVisitor& visitor, uint32_t numThreads);
+
+    // State for parallel visits; see visitParallel().
+    const Symbol* currentUnit = nullptr;
+    bool splitAtInstances = false;
 };
 
+namespace detail {
+
+// Finds every instance in the design that the visitor would visit.
+template<typename TVisitor>
+void collectInstances(const Scope& scope, TVisitor& visitor,
+                      std::vector<const InstanceSymbol*>& results) {
+    for (auto& member : scope.members()) {
+        switch (member.kind) {
+            case SymbolKind::ModuleInstance:
+            case SymbolKind::InterfaceInstance:
+                if (visitor.shouldEnter(member)) {
+                    results.push_back(&member.as<InstanceSymbol>());
+                    collectInstances(member.as<Scope>(), visitor, results);
+                }
+                break;
+            case SymbolKind::CompilationUnit:
+            case SymbolKind::Definition:
+            case SymbolKind::InstanceArray:
+            case SymbolKind::GenerateBlock:
+            case SymbolKind::GenerateBlockArray:
+                if (visitor.shouldEnter(member))
+                    collectInstances(member.as<Scope>(), visitor, results);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+} // namespace detail
+
+/// Visits the whole design, as with `compilation.getRoot().visit(visitor)`, but splits
+/// the work across the given number of threads. Each instance body is a separate unit
+/// of work; the units are divided into contiguous runs, one per thread, and each thread
+/// visits its run with its own copy of the visitor. Once all threads are done, each copy
+/// is merged back into the original visitor, in order, by calling its
+/// `void merge(TVisitor&& other)` method, so the results don't depend on timing.
+///
+/// Lazily computed parts of the AST can't be computed concurrently, so this first forces
+/// everything in the design to be computed, by way of Compilation::forceElaboration. That
+/// includes the parts skipped by semantic analysis if it aborted on the error limit.
+///
+/// Handlers must treat the AST as read-only. Anything that reaches state shared across
+/// the compilation is unsynchronized and must not be called from a handler: issuing
+/// diagnostics (Scope::addDiag, Compilation::addDiag), evaluating constants (Expression::eval,
+/// which uses the constant function call cache), or SubroutineSymbol::getLocalSlots. Record
+/// what is needed in the visitor and act on it from `merge` or after the visit returns.
+template<typename TVisitor>
+void visitParallel(Compilation& compilation, TVisitor& visitor, uint32_t numThreads) {
+    compilation.forceElaboration();
+
+    auto& root = compilation.getRoot();
+    std::vector<const InstanceSymbol*> units;
+    detail::collectInstances(root, visitor, units);
+
+    numThreads = std::max(numThreads, 1u);
+    std::vector<TVisitor> copies(numThreads - 1, visitor);
+
+    auto visitUnits = [&](TVisitor& v, uint32_t index) {
+        size_t begin = units.size() * index / numThreads;
+        size_t end = units.size() * (index + 1) / numThreads;
+
+        v.splitAtInstances = true;
+        for (size_t i = begin; i < end; i++) {
+            v.currentUnit = units[i];
+            units[i]->visit(v);
+        }
+        v.currentUnit = nullptr;
+        v.splitAtInstances = false;
+    };
+
+    std::vector<std::thread> threads;
+    for (uint32_t i = 1; i < numThreads; i++)
+        threads.emplace_back(visitUnits, std::ref(copies[i - 1]), i);
+
+    // Everything outside of instances is visited here, along with the first run of units.
+    visitor.splitAtInstances = true;
+    root.visit(visitor);
+    visitUnits(visitor, 0);
+
+    for (auto& thread : threads)
+        thread.join();
+
+    for (auto& copy : copies)
+        visitor.merge(std::move(copy));
+}
+
 template<typename TVisitor, typename... Args>
 decltype(auto) Symbol::visit(TVisitor& visitor, Args&&... args) const {
     // clang-format off
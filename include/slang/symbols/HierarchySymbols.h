@@ -6,6 +6,8 @@
 //------------------------------------------------------------------------------
 #pragma once
 
+#include <memory>
+
 #include "slang/binding/ConstantValue.h"
 #include "slang/symbols/SemanticFacts.h"
 #include "slang/symbols/StatementBodiedScope.h"
@@ -45,6 +47,31 @@ public:
     static bool isKind(SymbolKind kind) { return kind == SymbolKind::Package; }
 };
 
+/// Maps conditional generate constructs to whether their primary branch was selected.
+using GenerateSelectionMap = flat_hash_map<const SyntaxNode*, bool>;
+
+/// Holds conditional generate selections that can be shared by all instances of a definition
+/// that are instantiated with identical parameter override values. The first instance to
+/// elaborate a conditional generate construct records which branch it selected; later
+/// instances take that branch without evaluating the condition. Each instance still binds
+/// and evaluates its own parameters.
+class DefinitionSpecialization {
+public:
+    /// The parameter overrides that identify this specialization, with one entry for
+    /// each parameter in the definition (null for parameters that were not overridden).
+    std::vector<const Expression*> overrides;
+
+    /// Selected branches of conditional generate constructs in the instance body,
+    /// keyed by the generate syntax node.
+    GenerateSelectionMap generateSelections;
+
+    /// Determines whether this specialization was created for the given overrides.
+    bool matches(span<const Expression* const> otherOverrides) const;
+};
+
+using SpecializationMap =
+    flat_hash_map<size_t, std::vector<std::unique_ptr<DefinitionSpecialization>>>;
+
 /// Represents a definition (module, interface, or program) that can be instantiated
 /// to form a node in the design hierarchy.
 class DefinitionSymbol : public Symbol, public Scope {
@@ -65,6 +92,11 @@ public:
     const ModportSymbol* getModportOrError(string_view modport, const Scope& scope,
                                            SourceRange range) const;
 
+    /// Gets the specialization of this definition for the given parameter overrides,
+    /// creating it if necessary. Returns nullptr if instances with these overrides can't
+    /// share generate selections, such as when an override is not a constant.
+    DefinitionSpecialization* getSpecialization(span<const Expression* const> overrides) const;
+
     void toJson(json& j) const;
 
     static DefinitionSymbol& fromSyntax(Compilation& compilation,
@@ -73,6 +105,8 @@ public:
 
 private:
     SymbolMap* portMap;
+    mutable SpecializationMap* specializations = nullptr;
+    mutable optional<bool> canSpecialize;
 };
 
 /// Base class for module, interface, and program instance symbols.
@@ -85,6 +119,10 @@ public:
         return *portMap;
     }
 
+    /// Gets the specialization shared with other instances of the same definition
+    /// that have identical parameter overrides, if there is one.
+    DefinitionSpecialization* getSpecialization() const { return specialization; }
+
     void toJson(json& j) const;
 
     static void fromSyntax(Compilation& compilation, const HierarchyInstantiationSyntax& syntax,
@@ -102,6 +140,7 @@ protected:
 
 private:
     SymbolMap* portMap;
+    DefinitionSpecialization* specialization = nullptr;
 };
 
 class ModuleInstanceSymbol : public InstanceSymbol {
@@ -190,6 +229,10 @@ public:
     uint32_t constructIndex = 0;
     bool isInstantiated = false;
 
+    /// For blocks created by a loop generate construct, the value of the genvar
+    /// for the iteration that created the block.
+    int32_t arrayIndex = 0;
+
     GenerateBlockSymbol(Compilation& compilation, string_view name, SourceLocation loc,
                         uint32_t constructIndex, bool isInstantiated) :
         Symbol(SymbolKind::GenerateBlock, name, loc),
@@ -205,6 +248,9 @@ public:
 };
 
 /// Represents an array of generate blocks, as generated by a loop generate construct.
+/// The loop itself is evaluated up front, but only the genvar value of each iteration
+/// is kept until something looks at the array's members, at which point the blocks
+/// for all iterations are created.
 class GenerateBlockArraySymbol : public Symbol, public Scope {
 public:
     uint32_t constructIndex = 0;
@@ -214,6 +260,21 @@ public:
         Symbol(SymbolKind::GenerateBlockArray, name, loc),
         Scope(compilation, this), constructIndex(constructIndex) {}
 
+    /// Gets the number of iterations of the loop, without creating any blocks.
+    size_t getNumIterations() const { return size_t(genvarValues.size()); }
+
+    /// Gets the blocks created for each iteration of the loop, in iteration order.
+    span<const GenerateBlockSymbol* const> getEntries() const;
+
+    /// Finds the block created for the iteration with the given genvar value.
+    /// Returns nullptr if there is no such iteration.
+    const GenerateBlockSymbol* getEntry(int32_t index) const;
+
+    /// Gets the conditional generate selections shared by all of the iterations of the
+    /// loop. Only conditions that don't refer to the genvar or to anything else declared
+    /// within the loop body are included.
+    GenerateSelectionMap* getSharedSelections() const { return sharedSelections; }
+
     void toJson(json& j) const;
 
     /// Creates a generate block array from the given loop-generate syntax node.
@@ -223,6 +284,16 @@ public:
                                                 uint32_t constructIndex);
 
     static bool isKind(SymbolKind kind) { return kind == SymbolKind::GenerateBlockArray; }
+
+private:
+    friend class Scope;
+
+    // Called by Scope when the array's members are first needed.
+    void createBlocks();
+
+    span<const ConstantValue* const> genvarValues;
+    span<const GenerateBlockSymbol* const> entries;
+    GenerateSelectionMap* sharedSelections = nullptr;
 };
 
 /// Represents the entirety of a design, along with all contained compilation units.
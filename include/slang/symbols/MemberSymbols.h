@@ -233,6 +233,13 @@ protected:
                    VariableLifetime lifetime = VariableLifetime::Automatic, bool isConst = false) :
         ValueSymbol(childKind, name, loc),
         lifetime(lifetime), isConst(isConst) {}
+
+private:
+    friend class SubroutineSymbol;
+
+    // The index of this variable's storage within the evaluation frame of the subroutine
+    // that declares it, if any. Assigned when that subroutine's local layout is computed.
+    mutable uint32_t frameSlot = UINT32_MAX;
 };
 
 /// Represents a formal argument in subroutine (task or function).
@@ -272,6 +279,30 @@ public:
 
     const Type& getReturnType() const { return declaredReturnType.getType(); }
 
+    /// Gets the layout of local storage used when evaluating this subroutine. This includes
+    /// the arguments, the implicit return value variable, and all variables declared within
+    /// the body (including nested blocks). A variable's index in the returned span is the
+    /// slot that holds its value in an evaluation frame.
+    span<const VariableSymbol* const> getLocalSlots() const {
+        if (!localSlots)
+            computeLocalSlots();
+        return *localSlots;
+    }
+
+    /// Gets the frame slot for the given symbol, or nullopt if it is not a local of this
+    /// subroutine.
+    optional<uint32_t> getLocalSlot(const ValueSymbol& symbol) const {
+        if (!VariableSymbol::isKind(symbol.kind))
+            return std::nullopt;
+
+        uint32_t slot = symbol.as<VariableSymbol>().frameSlot;
+        auto slots = getLocalSlots();
+        if (slot >= slots.size() || slots[slot] != &symbol)
+            return std::nullopt;
+
+        return slot;
+    }
+
     void toJson(json& j) const;
 
     static SubroutineSymbol& fromSyntax(Compilation& compilation,
@@ -279,6 +310,11 @@ public:
                                         const Scope& parent);
 
     static bool isKind(SymbolKind kind) { return kind == SymbolKind::Subroutine; }
+
+private:
+    void computeLocalSlots() const;
+
+    mutable optional<span<const VariableSymbol* const>> localSlots;
 };
 
 /// Represents a modport within an interface definition.
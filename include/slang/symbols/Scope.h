@@ -17,6 +17,7 @@ namespace slang {
 
 class Compilation;
 class ForwardingTypedefSymbol;
+class GenerateBlockArraySymbol;
 class NetType;
 class Scope;
 class StatementBodiedScope;
@@ -69,6 +70,10 @@ public:
     /// A special location that should always compare before any other.
     static const LookupLocation min;
 
+    /// Gets the scope containing the location, or nullptr for the special
+    /// @a min and @a max locations.
+    const Scope* getScope() const { return scope; }
+
     bool operator==(const LookupLocation& other) const {
         return scope == other.scope && index == other.index;
     }
@@ -280,6 +285,10 @@ protected:
 
     void setStatement(StatementBodiedScope& stmt) { getOrAddDeferredData().setStatement(stmt); }
 
+    void setGenerateLoop(GenerateBlockArraySymbol& loop) {
+        getOrAddDeferredData().setGenerateLoop(loop);
+    }
+
     void setPortConnections(const SeparatedSyntaxList<PortConnectionSyntax>& connections) {
         getOrAddDeferredData().setPortConnections(connections);
     }
@@ -307,6 +316,9 @@ private:
         void setStatement(StatementBodiedScope& stmt);
         StatementBodiedScope* getStatement() const;
 
+        void setGenerateLoop(GenerateBlockArraySymbol& loop);
+        GenerateBlockArraySymbol* getGenerateLoop() const;
+
         void setPortConnections(const SeparatedSyntaxList<PortConnectionSyntax>& connections);
         const SeparatedSyntaxList<PortConnectionSyntax>* getPortConnections() const {
             return portConns;
@@ -327,7 +339,9 @@ private:
         // - A list of syntax nodes that represent deferred members that need to be elaborated
         //   before any lookups or iterations are done of members in the scope.
         // - A StatementBodiedScope.
-        std::variant<std::vector<Symbol*>, StatementBodiedScope*> membersOrStatement;
+        // - A generate loop whose iteration blocks have yet to be created.
+        std::variant<std::vector<Symbol*>, StatementBodiedScope*, GenerateBlockArraySymbol*>
+            membersOrStatement;
 
         // Some types are special in that their members leak into the surrounding scope; this
         // set keeps track of all variables, parameters, arguments, etc that have such data types
@@ -71,6 +71,10 @@ class Type;
 // clang-format on
 
 ENUM(SymbolKind, SYMBOLKIND)
+#define COUNT(x) +1
+/// The number of distinct symbol kinds.
+inline constexpr size_t SymbolKindCount = 0 SYMBOLKIND(COUNT);
+#undef COUNT
 #undef SYMBOLKIND
 
 /// Base class for all symbols (logical code constructs) such as modules, types,
@@ -96,6 +100,12 @@ public:
     /// the given kind, returns this symbol.
     const Symbol* findAncestor(SymbolKind searchKind) const;
 
+    /// Appends the full hierarchical path of this symbol (for example "top.u1.sig") to
+    /// the given buffer. Members of packages are named with the package as a prefix,
+    /// elements of instance and generate arrays are named by index, and unnamed
+    /// generate blocks get their "genblk" external names.
+    void getHierarchicalPath(std::string& buffer) const;
+
     /// Gets the syntax node that was used to create this symbol, if any. Symbols can
     /// be created without any originating syntax; in those cases, this returns nullptr.
     const SyntaxNode* getSyntax() const { return originatingSyntax; }
@@ -242,4 +252,8 @@ public:
 /// Serialization of arbitrary symbols to JSON.
 void to_json(json& j, const Symbol& symbol);
 
+/// Serializes just the properties of a symbol to JSON, leaving out the members
+/// of scopes. Used to stream out large hierarchies one symbol at a time.
+void propertiesToJson(json& j, const Symbol& symbol);
+
 } // namespace slang
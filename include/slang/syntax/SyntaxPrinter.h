@@ -57,6 +57,11 @@ public:
 
     std::string str() const { return buffer; }
 
+    /// Removes and returns all of the text printed so far. The printer remembers
+    /// where it left off, so this can be used to stream out a large amount of text
+    /// in pieces instead of building all of it up in memory.
+    std::string takeText();
+
     static std::string printFile(const SyntaxTree& tree);
 
 private:
@@ -64,6 +69,7 @@ private:
 
     std::string buffer;
     const SourceManager* sourceManager = nullptr;
+    char lastTaken = '\0';
     bool includeTrivia = true;
     bool includeMissing = false;
     bool includeSkipped = false;
@@ -7,6 +7,7 @@
 #pragma once
 
 #include <memory>
+#include <vector>
 
 #include "slang/diagnostics/Diagnostics.h"
 #include "slang/parsing/Parser.h"
@@ -92,6 +93,9 @@ private:
 
     static std::shared_ptr<SyntaxTree> create(SourceManager& sourceManager, SourceBuffer source,
                                               const Bag& options, bool guess);
+    static std::shared_ptr<SyntaxTree> createChunked(SourceManager& sourceManager,
+                                                     SourceBuffer source, const Bag& options,
+                                                     const std::vector<size_t>& boundaries);
 
     SyntaxNode* rootNode;
     SourceManager& sourceMan;
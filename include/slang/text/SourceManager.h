@@ -6,10 +6,13 @@
 //------------------------------------------------------------------------------
 #pragma once
 
+#include <atomic>
 #include <deque>
 #include <filesystem>
 #include <memory>
+#include <mutex>
 #include <set>
+#include <shared_mutex>
 #include <unordered_map>
 
 #include "slang/text/SourceLocation.h"
@@ -35,7 +38,8 @@ struct SourceBuffer {
 /// locations in files and locations generated by macro expansion.
 /// See SourceLocation for more details.
 ///
-/// TODO: The methods in this class should be thread safe.
+/// All methods in this class are thread safe, so multiple preprocessors can
+/// share one source manager while running in parallel.
 class SourceManager {
 public:
     SourceManager();
@@ -65,10 +69,18 @@ public:
     /// @a location must be a file location.
     uint32_t getColumnNumber(SourceLocation location) const;
 
+    /// Gets the full path of the file that the given buffer was loaded from, or an empty
+    /// string if the buffer didn't come from a file on disk.
+    std::string getFullPath(BufferID buffer) const;
+
     /// Gets a location that indicates from where the given buffer was included.
     /// @a location must be a file location.
     SourceLocation getIncludedFrom(BufferID buffer) const;
 
+    /// Gets all of the buffers that have been included into the given buffer so far,
+    /// either directly or by way of other included buffers.
+    std::vector<BufferID> getIncludedBuffers(BufferID buffer) const;
+
     /// Attempts to get the name of the macro represented by a macro location.
     /// If no macro name can be found, returns an empty string view.
     string_view getMacroName(SourceLocation location) const;
@@ -140,12 +152,22 @@ public:
     /// Read in a header file from disk.
     SourceBuffer readHeader(string_view path, SourceLocation includedFrom, bool isSystemPath);
 
+    /// Drops the cached contents of the given file, so that the next time it's requested
+    /// it will be read from disk again. Buffers already created for the file remain valid
+    /// and keep referring to the old contents.
+    void invalidateFile(string_view path);
+
     /// Adds a line directive at the given location.
     void addLineDirective(SourceLocation location, uint32_t lineNum, string_view name,
                           uint8_t level);
 
 private:
-    uint32_t unnamedBufferCount = 0;
+    // Protects the file caches, include directories, and line directives below, and
+    // serializes appends to the buffer entry table. Buffer entries and file contents
+    // never change once created, so queries about them don't take the lock.
+    mutable std::shared_mutex mut;
+
+    std::atomic<uint32_t> unnamedBufferCount = 0;
 
     // Stores information specified in a `line directive, which alters the
     // line number and file name that we report in diagnostics.
@@ -167,6 +189,8 @@ private:
         std::vector<uint32_t> lineOffsets;             // cache of compute line offsets
         std::vector<LineDirectiveInfo> lineDirectives; // cache of line directives
         const fs::path* directory;                     // directory in which the file exists
+        std::once_flag lineOffsetsFlag;                // guards lazy computation of lineOffsets
+        std::atomic<bool> hasLineDirectives = false;   // set once lineDirectives is non-empty
 
         FileData(const fs::path* directory, std::string name, std::vector<char>&& data) :
             name(std::move(name)), mem(std::move(data)), directory(directory) {}
@@ -214,12 +238,26 @@ private:
             expansionStart(expansionStart), expansionEnd(expansionEnd), macroName(macroName) {}
     };
 
-    // index from BufferID to buffer metadata
-    std::deque<std::variant<FileInfo, ExpansionInfo>> bufferEntries;
+    using BufferEntry = std::variant<FileInfo, ExpansionInfo>;
+
+    // Index from BufferID to buffer metadata. Entries live in fixed size chunks that never
+    // move, found through a table of chunk pointers. When the table fills up it's copied
+    // into a bigger one, and the old one is kept alive for readers that are still using it.
+    static_assert(std::is_trivially_destructible_v<BufferEntry>);
+    static constexpr uint32_t EntryChunkBits = 10;
+    static constexpr uint32_t EntryChunkSize = 1u << EntryChunkBits;
+    std::atomic<BufferEntry**> entryTable = nullptr;
+    std::atomic<uint32_t> entryCount = 0;
+    size_t entryTableSize = 0;
+    std::vector<std::unique_ptr<BufferEntry*[]>> entryTables;
+    std::vector<std::unique_ptr<std::byte[]>> entryChunks;
 
     // cache for file lookups; this holds on to the actual file data
     std::unordered_map<std::string, std::unique_ptr<FileData>> lookupCache;
 
+    // file data that has been invalidated but may still be referenced by existing buffers
+    std::vector<std::unique_ptr<FileData>> invalidatedFiles;
+
     // extra file data that came from programmatic buffers instead of a real file on disk
     std::deque<FileData> userFileBuffers;
 
@@ -230,16 +268,21 @@ private:
     // uniquified backing memory for directories
     std::set<fs::path> directories;
 
+    const BufferEntry& getEntry(BufferID buffer) const;
     FileData* getFileData(BufferID buffer) const;
+
+    // These require the caller to hold an exclusive lock on the mutex.
+    BufferID addEntry(BufferEntry&& entry);
     SourceBuffer createBufferEntry(FileData* fd, SourceLocation includedFrom);
 
+    // Get raw line number of a file location, ignoring any line directives
+    uint32_t getRawLineNumber(SourceLocation location) const;
+
+    // These take the lock themselves.
     SourceBuffer openCached(const fs::path& fullPath, SourceLocation includedFrom);
     SourceBuffer cacheBuffer(const fs::path& path, SourceLocation includedFrom,
                              std::vector<char>&& buffer);
 
-    // Get raw line number of a file location, ignoring any line directives
-    uint32_t getRawLineNumber(SourceLocation location) const;
-
     static void computeLineOffsets(const std::vector<char>& buffer, std::vector<uint32_t>& offsets);
 
     static bool readFile(const fs::path& path, std::vector<char>& buffer);
@@ -0,0 +1,62 @@
+//------------------------------------------------------------------------------
+// BinaryFormat.h
+// Helpers shared by the compact binary file formats.
+//
+// File is under the MIT license; see LICENSE for details.
+//------------------------------------------------------------------------------
+#pragma once
+
+#include <iosfwd>
+#include <string>
+
+#include "slang/util/Util.h"
+
+namespace slang {
+
+/// Describes one of the library's compact binary file formats, such as the binary AST
+/// written by ASTSerializer. Each starts with an eight character magic string and a version
+/// number; integers in the body are generally written as variable length integers,
+/// seven bits per byte, least significant group first.
+struct BinaryFormat {
+    /// The magic string that identifies files in this format.
+    string_view magic;
+
+    /// The current version of the format.
+    uint64_t version;
+
+    /// A human-readable name for the format, used in error messages.
+    string_view name;
+
+    /// Writes the magic string followed by the version as a variable length integer.
+    void writeHeader(std::ostream& stream) const;
+
+    /// Reads and checks a header written by writeHeader. Throws an exception if the
+    /// stream is not in this format or is from a different version of it.
+    void readHeader(std::istream& stream) const;
+
+    /// Reads a variable length integer from the stream. Throws an exception if the
+    /// stream ends early or the encoding is too long.
+    uint64_t readVarInt(std::istream& stream) const;
+
+    /// Reads a variable length integer starting at @a offset in the given buffer,
+    /// and advances @a offset past it. Throws an exception if the buffer ends early
+    /// or the encoding is too long.
+    uint64_t readVarInt(string_view buffer, size_t& offset) const;
+
+    /// Throws an exception reporting that data in this format is malformed.
+    [[noreturn]] void malformed() const;
+
+    /// Throws an exception reporting that data is not in this format at all.
+    [[noreturn]] void wrongFormat() const;
+
+    /// Throws an exception reporting that data is from an unsupported version of this format.
+    [[noreturn]] void wrongVersion() const;
+
+    /// Appends @a value to the buffer as a variable length integer.
+    static void appendVarInt(std::string& buffer, uint64_t value);
+
+    /// Writes @a value to the stream as a variable length integer.
+    static void writeVarInt(std::ostream& stream, uint64_t value);
+};
+
+} // namespace slang
@@ -18,4 +18,8 @@ uint64_t xxhash64(const void* input, size_t len, uint64_t seed);
 // uses 32-bit or 64-bit implementation depending on platform
 size_t xxhash(const void* input, size_t len, size_t seed);
 
+// 64-bit FNV-1a. Unlike xxhash above this gives the same result on every platform,
+// so it's suitable for hashes that get written into files.
+uint64_t fnv1a64(const void* input, size_t len);
+
 } // namespace slang
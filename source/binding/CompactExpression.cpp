@@ -0,0 +1,125 @@
+//------------------------------------------------------------------------------
+// CompactExpression.cpp
+// Compact post-order encoding of bound expression trees.
+//
+// File is under the MIT license; see LICENSE for details.
+//------------------------------------------------------------------------------
+#include "slang/binding/CompactExpression.h"
+
+#include "slang/util/SmallVector.h"
+
+namespace slang {
+
+uint32_t CompactExpressionSet::add(const Expression& expr) {
+    uint32_t root = encode(expr);
+    roots_.push_back(root);
+    return root;
+}
+
+uint32_t CompactExpressionSet::treeStart(uint32_t root) const {
+    return root + 1 - subtreeSizes[root];
+}
+
+uint32_t CompactExpressionSet::encode(const Expression& expr) {
+    SmallVectorSized<const Expression*, 4> operands;
+    uint8_t op = 0;
+
+    switch (expr.kind) {
+        case ExpressionKind::Invalid:
+        case ExpressionKind::IntegerLiteral:
+        case ExpressionKind::RealLiteral:
+        case ExpressionKind::UnbasedUnsizedIntegerLiteral:
+        case ExpressionKind::NullLiteral:
+        case ExpressionKind::StringLiteral:
+        case ExpressionKind::NamedValue:
+        case ExpressionKind::DataType:
+            break;
+        case ExpressionKind::UnaryOp: {
+            auto& unary = expr.as<UnaryExpression>();
+            op = uint8_t(unary.op);
+            operands.append(&unary.operand());
+            break;
+        }
+        case ExpressionKind::BinaryOp: {
+            auto& binary = expr.as<BinaryExpression>();
+            op = uint8_t(binary.op);
+            operands.append(&binary.left());
+            operands.append(&binary.right());
+            break;
+        }
+        case ExpressionKind::ConditionalOp: {
+            auto& cond = expr.as<ConditionalExpression>();
+            operands.append(&cond.pred());
+            operands.append(&cond.left());
+            operands.append(&cond.right());
+            break;
+        }
+        case ExpressionKind::Assignment: {
+            auto& assign = expr.as<AssignmentExpression>();
+            if (assign.op)
+                op = uint8_t(*assign.op);
+            operands.append(&assign.left());
+            operands.append(&assign.right());
+            break;
+        }
+        case ExpressionKind::Concatenation:
+            for (auto operand : expr.as<ConcatenationExpression>().operands())
+                operands.append(operand);
+            break;
+        case ExpressionKind::Replication: {
+            auto& repl = expr.as<ReplicationExpression>();
+            operands.append(&repl.count());
+            operands.append(&repl.concat());
+            break;
+        }
+        case ExpressionKind::ElementSelect: {
+            auto& select = expr.as<ElementSelectExpression>();
+            operands.append(&select.value());
+            operands.append(&select.selector());
+            break;
+        }
+        case ExpressionKind::RangeSelect: {
+            auto& select = expr.as<RangeSelectExpression>();
+            op = uint8_t(select.selectionKind);
+            operands.append(&select.value());
+            operands.append(&select.left());
+            operands.append(&select.right());
+            break;
+        }
+        case ExpressionKind::MemberAccess:
+            operands.append(&expr.as<MemberAccessExpression>().value());
+            break;
+        case ExpressionKind::Call:
+            for (auto arg : expr.as<CallExpression>().arguments())
+                operands.append(arg);
+            break;
+        case ExpressionKind::Conversion:
+            operands.append(&expr.as<ConversionExpression>().operand());
+            break;
+    }
+
+    // Children go first; their indices are collected here and then copied into
+    // the shared list once we know they're all done.
+    SmallVectorSized<uint32_t, 4> children;
+    uint32_t subtreeSize = 1;
+    for (auto operand : operands) {
+        uint32_t child = encode(*operand);
+        children.append(child);
+        subtreeSize += subtreeSizes[child];
+    }
+
+    Node node;
+    node.kind = expr.kind;
+    node.op = op;
+    node.numChildren = uint32_t(children.size());
+    node.firstChild = uint32_t(childIndices.size());
+    node.type = expr.type;
+    node.expr = &expr;
+
+    childIndices.insert(childIndices.end(), children.begin(), children.end());
+    nodes_.push_back(node);
+    subtreeSizes.push_back(subtreeSize);
+    return uint32_t(nodes_.size() - 1);
+}
+
+} // namespace slang
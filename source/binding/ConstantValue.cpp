@@ -10,6 +10,7 @@
 #include <nlohmann/json.hpp>
 
 #include "slang/text/FormatBuffer.h"
+#include "slang/util/Hash.h"
 
 namespace slang {
 
@@ -66,6 +67,67 @@ ConstantValue ConstantValue::getSlice(int32_t upper, int32_t lower) const {
     return nullptr;
 }
 
+size_t ConstantValue::hash(size_t seed) const {
+    // Mix in the kind of value so that e.g. empty strings and empty arrays differ.
+    size_t index = value.index();
+    seed = xxhash(&index, sizeof(index), seed);
+
+    return std::visit(
+        [seed](auto&& arg) noexcept {
+            using T = std::decay_t<decltype(arg)>;
+            if constexpr (std::is_same_v<T, std::monostate> ||
+                          std::is_same_v<T, ConstantValue::NullPlaceholder>)
+                return seed;
+            else if constexpr (std::is_same_v<T, SVInt>)
+                return arg.hash(seed);
+            else if constexpr (std::is_same_v<T, double>)
+                return xxhash(&arg, sizeof(arg), seed);
+            else if constexpr (std::is_same_v<T, Elements>) {
+                size_t result = seed;
+                for (auto& element : arg)
+                    result = element.hash(result);
+                return result;
+            }
+            else if constexpr (std::is_same_v<T, std::string>)
+                return xxhash(arg.data(), arg.size(), seed);
+            else
+                static_assert(always_false<T>::value, "Missing case");
+        },
+        value);
+}
+
+bool exactlyEqual(const ConstantValue& lhs, const ConstantValue& rhs) {
+    if (lhs.value.index() != rhs.value.index())
+        return false;
+
+    if (lhs.isInteger()) {
+        const SVInt& l = lhs.integer();
+        const SVInt& r = rhs.integer();
+        return l.getBitWidth() == r.getBitWidth() && l.isSigned() == r.isSigned() &&
+               exactlyEqual(l, r);
+    }
+
+    if (lhs.isReal())
+        return lhs.real() == rhs.real();
+
+    if (lhs.isString())
+        return lhs.str() == rhs.str();
+
+    if (lhs.isUnpacked()) {
+        auto le = lhs.elements();
+        auto re = rhs.elements();
+        if (le.size() != re.size())
+            return false;
+
+        for (ptrdiff_t i = 0; i < le.size(); i++) {
+            if (!exactlyEqual(le[i], re[i]))
+                return false;
+        }
+    }
+
+    return true;
+}
+
 void to_json(json& j, const ConstantValue& cv) {
     j = cv.toString();
 }
@@ -6,6 +6,7 @@
 //------------------------------------------------------------------------------
 #include "slang/binding/EvalContext.h"
 
+#include "slang/compilation/Compilation.h"
 #include "slang/symbols/MemberSymbols.h"
 #include "slang/symbols/TypeSymbols.h"
 #include "slang/text/FormatBuffer.h"
@@ -17,51 +18,150 @@ EvalContext::EvalContext(bool isScriptEval) : isScriptEval_(isScriptEval) {
 }
 
 ConstantValue* EvalContext::createLocal(const ValueSymbol* symbol, ConstantValue value) {
-    ConstantValue& result = stack.back().temporaries[symbol];
-    ASSERT(!result);
+    ConstantValue* result;
+    Frame& frame = stack.back();
+    if (frame.subroutine) {
+        auto slot = frame.subroutine->getLocalSlot(*symbol);
+        ASSERT(slot);
+        result = &frame.locals[*slot];
+    }
+    else {
+        result = &temporaries[symbol];
+    }
+
+    ASSERT(!*result);
 
     if (!value)
-        result = symbol->getType().getDefaultValue();
+        *result = symbol->getType().getDefaultValue();
     else {
         ASSERT(!value.isInteger() ||
                value.integer().getBitWidth() == symbol->getType().getBitWidth());
 
-        result = std::move(value);
+        *result = std::move(value);
     }
 
-    return &result;
+    return result;
 }
 
 ConstantValue* EvalContext::findLocal(const ValueSymbol* symbol) {
-    auto it = stack.back().temporaries.find(symbol);
-    if (it == stack.back().temporaries.end())
+    Frame& frame = stack.back();
+    if (frame.subroutine) {
+        // Slots for locals that haven't been created yet are left empty.
+        auto slot = frame.subroutine->getLocalSlot(*symbol);
+        if (!slot || !frame.locals[*slot])
+            return nullptr;
+        return &frame.locals[*slot];
+    }
+
+    auto it = temporaries.find(symbol);
+    if (it == temporaries.end())
         return nullptr;
     return &it->second;
 }
 
-void EvalContext::pushFrame(const SubroutineSymbol& subroutine, SourceLocation callLocation,
+bool EvalContext::pushFrame(const SubroutineSymbol& subroutine, SourceLocation callLocation,
                             LookupLocation lookupLocation) {
-    Frame frame;
+    if (!limitsInitialized) {
+        auto& options = getCallCompilation(subroutine, lookupLocation).getOptions();
+        maxSteps = options.maxConstexprSteps;
+        maxDepth = options.maxConstexprDepth;
+        maxTime = options.maxConstexprTime;
+        profiling = options.profileConstantFunctions;
+        startTime = std::chrono::steady_clock::now();
+        limitsInitialized = true;
+    }
+
+    // The first frame is the global one, which doesn't count towards the depth.
+    if (maxDepth && stack.size() > maxDepth) {
+        if (!std::exchange(budgetExceeded, true))
+            addDiag(DiagCode::NoteExceededMaxCallDepth, callLocation) << maxDepth;
+        return false;
+    }
+
+    if (!step(callLocation))
+        return false;
+
+    Frame& frame = stack.emplace_back();
     frame.subroutine = &subroutine;
     frame.callLocation = callLocation;
     frame.lookupLocation = lookupLocation;
-    stack.emplace_back(std::move(frame));
+    if (profiling)
+        frame.startTime = std::chrono::steady_clock::now();
+
+    if (!localsPool.empty()) {
+        frame.locals = std::move(localsPool.back());
+        localsPool.pop_back();
+    }
+    frame.locals.resize(subroutine.getLocalSlots().size());
+    return true;
+}
+
+Compilation& EvalContext::getCallCompilation(const SubroutineSymbol& subroutine,
+                                             LookupLocation lookupLocation) {
+    Compilation& compilation = subroutine.getCompilation();
+    if (compilation.isFrozen() && lookupLocation.getScope())
+        return lookupLocation.getScope()->getCompilation();
+    return compilation;
 }
 
 ConstantValue EvalContext::popFrame() {
     ConstantValue result;
     Frame& frame = stack.back();
     if (frame.subroutine) {
-        ConstantValue* storage = findLocal(frame.subroutine->returnValVar);
-        ASSERT(storage);
-        if (storage)
-            result = std::move(*storage);
+        auto slot = frame.subroutine->getLocalSlot(*frame.subroutine->returnValVar);
+        ASSERT(slot);
+        if (slot)
+            result = std::move(frame.locals[*slot]);
+    }
+
+    if (profiling) {
+        ConstantCallProfile sample;
+        sample.subroutine = frame.subroutine;
+        sample.callLocation = frame.callLocation;
+        sample.calls = 1;
+        sample.expressions = frame.expressions;
+        sample.loopIterations = frame.loopIterations;
+        sample.time = std::chrono::steady_clock::now() - frame.startTime;
+        getCallCompilation(*frame.subroutine, frame.lookupLocation).recordConstantCall(sample);
     }
 
+    Frame callee = std::move(frame);
     stack.pop_back();
+
+    // If the callee depended on outside state, so does the caller. Profiling
+    // counts are inclusive of everything done by called functions.
+    Frame& caller = stack.back();
+    caller.dependsOnContext |= callee.dependsOnContext;
+    caller.expressions += callee.expressions;
+    caller.loopIterations += callee.loopIterations;
+
+    callee.locals.clear();
+    localsPool.emplace_back(std::move(callee.locals));
     return result;
 }
 
+bool EvalContext::step(SourceLocation location) {
+    if (budgetExceeded)
+        return false;
+
+    steps++;
+    if (maxSteps && steps > maxSteps) {
+        budgetExceeded = true;
+        addDiag(DiagCode::NoteExceededMaxSteps, location) << maxSteps;
+        return false;
+    }
+
+    // Checking the clock is relatively expensive, so only do it periodically.
+    if (maxTime.count() && (steps % 1024) == 0 &&
+        std::chrono::steady_clock::now() - startTime > maxTime) {
+        budgetExceeded = true;
+        addDiag(DiagCode::NoteExceededMaxTime, location) << maxTime.count();
+        return false;
+    }
+
+    return true;
+}
+
 void EvalContext::setReturned(ConstantValue value) {
     Frame& frame = stack.back();
     frame.hasReturned = true;
@@ -69,33 +169,48 @@ void EvalContext::setReturned(ConstantValue value) {
     const SubroutineSymbol* subroutine = frame.subroutine;
     ASSERT(subroutine);
 
-    ConstantValue* storage = findLocal(subroutine->returnValVar);
-    ASSERT(storage);
+    auto slot = subroutine->getLocalSlot(*subroutine->returnValVar);
+    ASSERT(slot);
 
-    *storage = std::move(value);
+    frame.locals[*slot] = std::move(value);
 }
 
 std::string EvalContext::dumpStack() const {
     FormatBuffer buffer;
     int index = 0;
     for (const Frame& frame : stack) {
-        buffer.format("{}: {}\n", index++, frame.subroutine ? frame.subroutine->name : "<global>");
-        for (auto& [symbol, value] : frame.temporaries)
-            buffer.format("    {} = {}\n", symbol->name, value.toString());
+        if (!frame.subroutine) {
+            buffer.format("{}: <global>\n", index++);
+            for (auto& [symbol, value] : temporaries)
+                buffer.format("    {} = {}\n", symbol->name, value.toString());
+            continue;
+        }
+
+        buffer.format("{}: {}\n", index++, frame.subroutine->name);
+        auto slots = frame.subroutine->getLocalSlots();
+        for (ptrdiff_t i = 0; i < slots.size(); i++) {
+            auto& value = frame.locals[size_t(i)];
+            if (value)
+                buffer.format("    {} = {}\n", slots[i]->name, value.toString());
+        }
     }
     return buffer.str();
 }
 
 Diagnostic& EvalContext::addDiag(DiagCode code, SourceLocation location) {
-    Diagnostic& diag = diags.add(code, location);
+    // Reporting the stack can add more diagnostics and move existing ones,
+    // so look up the new diagnostic again afterwards.
+    size_t index = diags.size();
+    diags.add(code, location);
     reportStack();
-    return diag;
+    return diags[index];
 }
 
 Diagnostic& EvalContext::addDiag(DiagCode code, SourceRange range) {
-    Diagnostic& diag = diags.add(code, range);
+    size_t index = diags.size();
+    diags.add(code, range);
     reportStack();
-    return diag;
+    return diags[index];
 }
 
 void EvalContext::reportStack() {
@@ -104,19 +219,34 @@ void EvalContext::reportStack() {
     if (std::exchange(reportedCallstack, true))
         return;
 
+    // Deep (e.g. runaway recursive) call stacks only report the innermost and
+    // outermost few frames.
+    const size_t MaxFrames = 10;
+    size_t numFrames = stack.size() - 1;
+    size_t index = 0;
+
     FormatBuffer buffer;
     for (const Frame& frame : make_reverse_range(stack)) {
         if (!frame.subroutine)
             break;
 
+        size_t current = index++;
+        if (numFrames > MaxFrames && current >= MaxFrames / 2 &&
+            current < numFrames - MaxFrames / 2) {
+            if (current == MaxFrames / 2)
+                diags.add(DiagCode::NoteSkippedFrames, frame.callLocation)
+                    << numFrames - MaxFrames;
+            continue;
+        }
+
         buffer.clear();
         buffer.format("{}(", frame.subroutine->name);
 
         for (auto arg : frame.subroutine->arguments) {
-            auto it = frame.temporaries.find(arg);
-            ASSERT(it != frame.temporaries.end());
+            auto slot = frame.subroutine->getLocalSlot(*arg);
+            ASSERT(slot);
 
-            buffer.append(it->second.toString());
+            buffer.append(frame.locals[*slot].toString());
             if (arg != frame.subroutine->arguments.last(1)[0])
                 buffer.append(", ");
         }
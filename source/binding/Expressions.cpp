@@ -145,6 +145,102 @@ void checkBindFlags(const Expression& expr, const BindContext& context) {
     }
 }
 
+// Determines whether binding the given expression syntax gives the same result no matter
+// which scope it's bound in, which is true for expressions made up only of literals,
+// operators, and references to members of packages.
+bool isContextIndependent(const ExpressionSyntax& syntax, const Scope& scope) {
+    switch (syntax.kind) {
+        case SyntaxKind::NullLiteralExpression:
+        case SyntaxKind::StringLiteralExpression:
+        case SyntaxKind::RealLiteralExpression:
+        case SyntaxKind::IntegerLiteralExpression:
+        case SyntaxKind::UnbasedUnsizedLiteralExpression:
+        case SyntaxKind::IntegerVectorExpression:
+            return true;
+        case SyntaxKind::ParenthesizedExpression:
+            return isContextIndependent(*syntax.as<ParenthesizedExpressionSyntax>().expression,
+                                        scope);
+        case SyntaxKind::UnaryPlusExpression:
+        case SyntaxKind::UnaryMinusExpression:
+        case SyntaxKind::UnaryBitwiseNotExpression:
+        case SyntaxKind::UnaryBitwiseAndExpression:
+        case SyntaxKind::UnaryBitwiseOrExpression:
+        case SyntaxKind::UnaryBitwiseXorExpression:
+        case SyntaxKind::UnaryBitwiseNandExpression:
+        case SyntaxKind::UnaryBitwiseNorExpression:
+        case SyntaxKind::UnaryBitwiseXnorExpression:
+        case SyntaxKind::UnaryLogicalNotExpression:
+            return isContextIndependent(*syntax.as<PrefixUnaryExpressionSyntax>().operand, scope);
+        case SyntaxKind::AddExpression:
+        case SyntaxKind::SubtractExpression:
+        case SyntaxKind::MultiplyExpression:
+        case SyntaxKind::DivideExpression:
+        case SyntaxKind::ModExpression:
+        case SyntaxKind::BinaryAndExpression:
+        case SyntaxKind::BinaryOrExpression:
+        case SyntaxKind::BinaryXorExpression:
+        case SyntaxKind::BinaryXnorExpression:
+        case SyntaxKind::EqualityExpression:
+        case SyntaxKind::InequalityExpression:
+        case SyntaxKind::CaseEqualityExpression:
+        case SyntaxKind::CaseInequalityExpression:
+        case SyntaxKind::GreaterThanEqualExpression:
+        case SyntaxKind::GreaterThanExpression:
+        case SyntaxKind::LessThanEqualExpression:
+        case SyntaxKind::LessThanExpression:
+        case SyntaxKind::WildcardEqualityExpression:
+        case SyntaxKind::WildcardInequalityExpression:
+        case SyntaxKind::LogicalAndExpression:
+        case SyntaxKind::LogicalOrExpression:
+        case SyntaxKind::LogicalImplicationExpression:
+        case SyntaxKind::LogicalEquivalenceExpression:
+        case SyntaxKind::LogicalShiftLeftExpression:
+        case SyntaxKind::LogicalShiftRightExpression:
+        case SyntaxKind::ArithmeticShiftLeftExpression:
+        case SyntaxKind::ArithmeticShiftRightExpression:
+        case SyntaxKind::PowerExpression: {
+            auto& binary = syntax.as<BinaryExpressionSyntax>();
+            return isContextIndependent(*binary.left, scope) &&
+                   isContextIndependent(*binary.right, scope);
+        }
+        case SyntaxKind::ConditionalExpression: {
+            auto& cond = syntax.as<ConditionalExpressionSyntax>();
+            auto& conditions = cond.predicate->conditions;
+            return conditions.size() == 1 && !conditions[0]->matchesClause &&
+                   isContextIndependent(*conditions[0]->expr, scope) &&
+                   isContextIndependent(*cond.left, scope) &&
+                   isContextIndependent(*cond.right, scope);
+        }
+        case SyntaxKind::ConcatenationExpression:
+            for (auto expr : syntax.as<ConcatenationExpressionSyntax>().expressions) {
+                if (!isContextIndependent(*expr, scope))
+                    return false;
+            }
+            return true;
+        case SyntaxKind::MultipleConcatenationExpression: {
+            auto& replication = syntax.as<MultipleConcatenationExpressionSyntax>();
+            return isContextIndependent(*replication.expression, scope) &&
+                   isContextIndependent(*replication.concatenation, scope);
+        }
+        case SyntaxKind::ScopedName: {
+            // A reference to a package member; the prefix has to be a package name that
+            // isn't hidden by a class or some other symbol visible from this scope.
+            auto& scoped = syntax.as<ScopedNameSyntax>();
+            if (scoped.separator.kind != TokenKind::DoubleColon ||
+                scoped.left->kind != SyntaxKind::IdentifierName ||
+                scoped.right->kind != SyntaxKind::IdentifierName) {
+                return false;
+            }
+
+            auto name = scoped.left->as<IdentifierNameSyntax>().identifier.valueText();
+            return scope.getCompilation().getPackage(name) &&
+                   !scope.lookupUnqualifiedName(name, LookupLocation::max, scoped.sourceRange());
+        }
+        default:
+            return false;
+    }
+}
+
 } // namespace
 
 namespace slang {
@@ -204,22 +300,47 @@ struct Expression::PropagationVisitor {
 
 const InvalidExpression InvalidExpression::Instance(nullptr, ErrorType::Instance);
 
+template<typename TBind>
+const Expression& Expression::bindCached(Compilation& compilation, const ExpressionSyntax& syntax,
+                                         const Type* targetType, const BindContext& context,
+                                         TBind&& bindFunc) {
+    if (!compilation.getOptions().cacheExpressionBinding ||
+        !isContextIndependent(syntax, context.scope)) {
+        return bindFunc();
+    }
+
+    if (auto cached = compilation.findBoundExpression(syntax, targetType, context.flags))
+        return *cached;
+
+    // Only cache the result if binding it didn't issue any diagnostics; otherwise each
+    // scope needs to get the chance to report them on its own.
+    uint64_t numDiags = compilation.getNumDiagsIssued();
+    const Expression& result = bindFunc();
+    if (compilation.getNumDiagsIssued() == numDiags)
+        compilation.cacheBoundExpression(syntax, targetType, context.flags, result);
+    return result;
+}
+
 const Expression& Expression::bind(const ExpressionSyntax& syntax, const BindContext& context,
                                    bitmask<BindFlags> extraFlags) {
-    const Expression& result =
-        selfDetermined(context.scope.getCompilation(), syntax, context, extraFlags);
-    checkBindFlags(result, context.resetFlags(extraFlags));
-    return result;
+    Compilation& comp = context.scope.getCompilation();
+    return bindCached(comp, syntax, nullptr, context.resetFlags(extraFlags), [&]() -> auto& {
+        const Expression& result = selfDetermined(comp, syntax, context, extraFlags);
+        checkBindFlags(result, context.resetFlags(extraFlags));
+        return result;
+    });
 }
 
 const Expression& Expression::bind(const Type& lhs, const ExpressionSyntax& rhs,
                                    SourceLocation location, const BindContext& context) {
     Compilation& comp = context.scope.getCompilation();
-    Expression& expr = create(comp, rhs, context);
+    return bindCached(comp, rhs, &lhs, context, [&]() -> auto& {
+        Expression& expr = create(comp, rhs, context);
 
-    const Expression& result = convertAssignment(context.scope, lhs, expr, location);
-    checkBindFlags(result, context);
-    return result;
+        const Expression& result = convertAssignment(context.scope, lhs, expr, location);
+        checkBindFlags(result, context);
+        return result;
+    });
 }
 
 bool Expression::bad() const {
@@ -441,6 +562,15 @@ Expression& Expression::bindName(Compilation& compilation, const NameSyntax& syn
         return *compilation.emplace<DataTypeExpression>(resultType, syntax.sourceRange());
     }
 
+    // Within a function body the function's name refers to its implicit return value
+    // variable, unless it's being invoked, in which case it's a recursive call.
+    if (invocation && symbol->kind == SymbolKind::Variable) {
+        const Symbol& parent = symbol->getScope()->asSymbol();
+        if (parent.kind == SymbolKind::Subroutine &&
+            parent.as<SubroutineSymbol>().returnValVar == symbol)
+            symbol = &parent;
+    }
+
     Expression* expr;
     if (symbol->kind == SymbolKind::Subroutine) {
         expr = &CallExpression::fromLookup(compilation, &symbol->as<SubroutineSymbol>(), invocation,
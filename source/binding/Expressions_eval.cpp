@@ -25,6 +25,7 @@ struct EvalVisitor {
             return nullptr;
 
         // Otherwise evaluate and return that.
+        context.countExpression();
         return expr.evalImpl(context);
     }
 
@@ -332,6 +333,9 @@ ConstantValue NamedValueExpression::evalImpl(EvalContext& context) const {
 
     switch (symbol.kind) {
         case SymbolKind::Parameter:
+            // Parameter values (and whether they may be referenced at all) depend on
+            // where the call happens, not just on the values of the arguments.
+            context.markContextDependent();
             return symbol.as<ParameterSymbol>().getValue();
         case SymbolKind::EnumValue:
             return symbol.as<EnumValueSymbol>().getValue();
@@ -826,9 +830,17 @@ ConstantValue CallExpression::evalImpl(EvalContext& context) const {
         args.emplace(std::move(v));
     }
 
-    // Push a new stack frame, push argument values as locals.
+    // If we've already evaluated this exact call before, reuse the result.
     const SubroutineSymbol& symbol = *std::get<0>(subroutine);
-    context.pushFrame(symbol, sourceRange.start(), lookupLocation);
+    Compilation& compilation = EvalContext::getCallCompilation(symbol, lookupLocation);
+    if (auto cached = compilation.findConstantCall(symbol, args))
+        return *cached;
+
+    // Push a new stack frame, push argument values as locals.
+    size_t diagCount = context.getDiagnostics().size();
+    if (!context.pushFrame(symbol, sourceRange.start(), lookupLocation))
+        return nullptr;
+
     span<const FormalArgumentSymbol* const> formals = symbol.arguments;
     for (uint32_t i = 0; i < formals.size(); i++)
         context.createLocal(formals[i], args[i]);
@@ -836,9 +848,17 @@ ConstantValue CallExpression::evalImpl(EvalContext& context) const {
     context.createLocal(symbol.returnValVar);
 
     bool succeeded = symbol.getBody()->eval(context);
+    bool dependsOnContext = context.topFrame().dependsOnContext;
     ConstantValue result = context.popFrame();
 
-    return succeeded ? result : nullptr;
+    if (!succeeded)
+        return nullptr;
+
+    // Only results that are fully determined by the argument values can be reused.
+    if (result && !dependsOnContext && context.getDiagnostics().size() == diagCount)
+        compilation.cacheConstantCall(symbol, args, result);
+
+    return result;
 }
 
 ConstantValue ConversionExpression::evalImpl(EvalContext& context) const {
@@ -90,7 +90,11 @@ bool ForLoopStatement::eval(EvalContext& context) const {
     if (!initializers.eval(context))
         return false;
 
+    SourceLocation loc = syntax->getFirstToken().location();
     while (true) {
+        if (!context.stepLoop(loc))
+            return false;
+
         if (stopExpr) {
             auto result = stopExpr->eval(context);
             if (result.bad())
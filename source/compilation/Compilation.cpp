@@ -9,6 +9,7 @@
 #include "BuiltInSubroutines.h"
 #include <nlohmann/json.hpp>
 
+#include "slang/diagnostics/DiagnosticWriter.h"
 #include "slang/parsing/Preprocessor.h"
 #include "slang/symbols/ASTVisitor.h"
 #include "slang/syntax/SyntaxTree.h"
@@ -35,8 +36,14 @@ struct ElaborationVisitor : public ASTVisitor<ElaborationVisitor> {
 // This visitor is used to touch every node in the AST to ensure that all lazily
 // evaluated members have been realized and we have recorded every diagnostic.
 struct DiagnosticVisitor : public ASTVisitor<DiagnosticVisitor> {
+    explicit DiagnosticVisitor(const Compilation& compilation) : compilation(compilation) {}
+
     template<typename T>
     void handle(const T& symbol) {
+        // Once we've given up on elaboration there's no point in digging any further.
+        if (compilation.isAborting())
+            return;
+
         if constexpr (std::is_base_of_v<Symbol, T>) {
             auto declaredType = symbol.getDeclaredType();
             if (declaredType) {
@@ -44,19 +51,65 @@ struct DiagnosticVisitor : public ASTVisitor<DiagnosticVisitor> {
                 declaredType->getInitializer();
             }
         }
+
+        if constexpr (std::is_same_v<PortSymbol, T>)
+            symbol.getExternalConnection();
+
         visitDefault(symbol);
     }
     void handle(const ExplicitImportSymbol& symbol) { symbol.importedSymbol(); }
     void handle(const WildcardImportSymbol& symbol) { symbol.getPackage(); }
     void handle(const ContinuousAssignSymbol& symbol) { symbol.getAssignment(); }
+
+    const Compilation& compilation;
+};
+
+// This visitor realizes all of the remaining lazily computed state, including the parts that
+// the DiagnosticVisitor skips after aborting, so that nothing computes it later on demand.
+// Frozen compilations are read by the compilations they're attached to, and parallel
+// visits read the design from many threads at once.
+struct ForceVisitor : public ASTVisitor<ForceVisitor> {
+    template<typename T>
+    void handle(const T& symbol) {
+        if constexpr (std::is_base_of_v<Symbol, T>) {
+            auto declaredType = symbol.getDeclaredType();
+            if (declaredType) {
+                declaredType->getType();
+                declaredType->getInitializer();
+            }
+        }
+
+        if constexpr (std::is_same_v<PortSymbol, T>)
+            symbol.getExternalConnection();
+        if constexpr (std::is_same_v<TypeAliasType, T>)
+            symbol.getCanonicalType();
+        if constexpr (std::is_same_v<SubroutineSymbol, T>)
+            symbol.getLocalSlots();
+
+        visitDefault(symbol);
+    }
+    void handle(const NetType& symbol) {
+        symbol.getCanonical();
+        symbol.getResolutionFunction();
+    }
+    void handle(const ExplicitImportSymbol& symbol) { symbol.importedSymbol(); }
+    void handle(const WildcardImportSymbol& symbol) { symbol.getPackage(); }
+    void handle(const ContinuousAssignSymbol& symbol) { symbol.getAssignment(); }
 };
 
 } // namespace
 
 namespace slang {
 
-Compilation::Compilation() :
-    bitType(ScalarType::Bit), logicType(ScalarType::Logic), regType(ScalarType::Reg),
+// This is defined in the generated DiagCode.cpp file.
+DiagnosticSeverity getSeverity(DiagCode code);
+
+// Marks entries in the diagnostic map that were counted but dropped because of a limit.
+static constexpr size_t DroppedDiag = SIZE_MAX;
+
+Compilation::Compilation(const Bag& options_) :
+    options(options_.getOrDefault<CompilationOptions>()), bitType(ScalarType::Bit),
+    logicType(ScalarType::Logic), regType(ScalarType::Reg),
     signedBitType(ScalarType::Bit, true), signedLogicType(ScalarType::Logic, true),
     signedRegType(ScalarType::Reg, true), shortIntType(PredefinedIntegerType::ShortInt),
     intType(PredefinedIntegerType::Int), longIntType(PredefinedIntegerType::LongInt),
@@ -250,6 +303,45 @@ const RootSymbol& Compilation::getRoot() {
     return *root;
 }
 
+void Compilation::freeze() {
+    if (frozen)
+        return;
+
+    getAllDiagnostics();
+    forceElaboration();
+    frozen = true;
+}
+
+void Compilation::forceElaboration() {
+    if (forced)
+        return;
+
+    getSemanticDiagnostics();
+
+    ForceVisitor visitor;
+    root->visit(visitor);
+    forced = true;
+}
+
+void Compilation::attach(const Compilation& fragment) {
+    if (finalized)
+        throw std::logic_error("The compilation has already been finalized");
+
+    if (!fragment.isFrozen())
+        throw std::logic_error("Only frozen compilations can be attached to another");
+
+    if (fragment.sourceManager != sourceManager) {
+        if (!sourceManager)
+            sourceManager = fragment.sourceManager;
+        else if (fragment.sourceManager) {
+            throw std::logic_error(
+                "Attached compilations must use the same source manager as their attacher");
+        }
+    }
+
+    attachedFragments.push_back(&fragment);
+}
+
 const CompilationUnitSymbol* Compilation::getCompilationUnit(
     const CompilationUnitSyntax& syntax) const {
 
@@ -299,9 +391,14 @@ void Compilation::addDefinition(const DefinitionSymbol& definition) {
 
 const PackageSymbol* Compilation::getPackage(string_view lookupName) const {
     auto it = packageMap.find(lookupName);
-    if (it == packageMap.end())
-        return nullptr;
-    return it->second;
+    if (it != packageMap.end())
+        return it->second;
+
+    for (auto fragment : attachedFragments) {
+        if (auto package = fragment->getPackage(lookupName))
+            return package;
+    }
+    return nullptr;
 }
 
 void Compilation::addPackage(const PackageSymbol& package) {
@@ -403,52 +500,15 @@ const Diagnostics& Compilation::getSemanticDiagnostics() {
 
     // If we haven't already done so, touch every symbol, scope, statement,
     // and expression tree so that we can be sure we have all the diagnostics.
-    DiagnosticVisitor visitor;
+    DiagnosticVisitor visitor(*this);
     getRoot().visit(visitor);
 
-    // Go through all diagnostics and build a map from source location / code to the
-    // actual diagnostic. The purpose is to find duplicate diagnostics issued by several
-    // instantiations and collapse them down to one output for the user.
-    flat_hash_map<std::tuple<DiagCode, SourceLocation>,
-                  std::pair<const Diagnostic*, std::vector<const Diagnostic*>>>
-        diagMap;
-
-    for (auto& diag : diags) {
-        ASSERT(diag.symbol);
-        if (diag.isSuppressed())
-            continue;
-
-        if (auto it = diagMap.find({ diag.code, diag.location }); it != diagMap.end()) {
-            it->second.second.push_back(&diag);
-            if (diag.symbol->kind == SymbolKind::Definition)
-                it->second.first = &diag;
-        }
-        else {
-            std::pair<const Diagnostic*, std::vector<const Diagnostic*>> newEntry;
-            newEntry.second.push_back(&diag);
-            if (diag.symbol->kind == SymbolKind::Definition)
-                newEntry.first = &diag;
-
-            diagMap.emplace(std::make_tuple(diag.code, diag.location), std::move(newEntry));
-        }
-    }
-
+    // Duplicates have already been collapsed as diagnostics were added, but a few may
+    // have been issued before their containing generate block was known to be uninstantiated.
     Diagnostics results;
-    for (auto& pair : diagMap) {
-        auto& [definition, diagList] = pair.second;
-        if (diagList.size() == 1)
-            results.append(*diagList.front());
-        else {
-            // If we get here there are multiple duplicate diagnostics issued. Pick the one that
-            // came from a Definition, if there is one. Otherwise just pick whatever the first one
-            // is.
-            // TODO: in the future this could print out the hierarchical paths or parameter values
-            // involves with the instantiations to provide more insight as to what caused the error.
-            if (definition)
-                results.append(*definition);
-            else
-                results.append(*diagList.front());
-        }
+    for (auto& diag : diags) {
+        if (!diag.isSuppressed())
+            results.append(diag);
     }
 
     if (sourceManager)
@@ -468,11 +528,97 @@ const Diagnostics& Compilation::getAllDiagnostics() {
 
     if (sourceManager)
         cachedAllDiagnostics->sort(*sourceManager);
+
+    // Semantic diagnostics have already been limited as they were issued; do it again
+    // here so that the limits cover the parse diagnostics as well.
+    if (options.errorLimit || options.maxDiagsPerCode) {
+        Diagnostics limited;
+        flat_hash_map<DiagCode, uint32_t> counts;
+        uint32_t errors = 0;
+        for (auto& diag : *cachedAllDiagnostics) {
+            if (options.maxDiagsPerCode && ++counts[diag.code] > options.maxDiagsPerCode)
+                continue;
+
+            if (getSeverity(diag.code) == DiagnosticSeverity::Error) {
+                if (options.errorLimit && errors == options.errorLimit)
+                    continue;
+                errors++;
+            }
+            limited.append(diag);
+        }
+        cachedAllDiagnostics.emplace(std::move(limited));
+    }
     return *cachedAllDiagnostics;
 }
 
+flat_hash_map<DiagCode, uint32_t> Compilation::getDiagnosticCounts() {
+    getSemanticDiagnostics();
+
+    auto counts = diagCounts;
+    for (auto& diag : getParseDiagnostics())
+        counts[diag.code]++;
+    return counts;
+}
+
 void Compilation::addDiagnostics(const Diagnostics& diagnostics) {
-    diags.appendRange(diagnostics);
+    for (auto& diag : diagnostics) {
+        ASSERT(diag.symbol);
+        Diagnostic& added = addDiag(*diag.symbol, diag.code, diag.location);
+        if (&added != &discardedDiag)
+            added = diag;
+    }
+}
+
+Diagnostic& Compilation::addDiag(const Symbol& source, DiagCode code, SourceLocation location) {
+    numDiagsIssued++;
+    auto discard = [&]() -> Diagnostic& {
+        discardedDiag.args.clear();
+        discardedDiag.ranges.clear();
+        discardedDiag.notes.clear();
+        discardedDiag.code = code;
+        discardedDiag.location = location;
+        discardedDiag.symbol = &source;
+        return discardedDiag;
+    };
+
+    // Diagnostics in uninstantiated generate blocks are never reported, so don't store them.
+    Diagnostic diag(source, code, location);
+    if (diag.isSuppressed())
+        return discard();
+
+    auto [it, inserted] = diagMap.emplace(std::make_tuple(code, location), diags.size());
+    if (inserted) {
+        // This is a new diagnostic; count it and then see whether we're over any of
+        // our limits. If we are, it's remembered so that duplicates are still recognized,
+        // but otherwise dropped.
+        bool isError = getSeverity(code) == DiagnosticSeverity::Error;
+        bool overLimit = isError && errorLimitReached();
+        if (isError)
+            numErrors++;
+
+        uint32_t count = ++diagCounts[code];
+        if (options.maxDiagsPerCode && count > options.maxDiagsPerCode)
+            overLimit = true;
+
+        if (overLimit) {
+            it->second = DroppedDiag;
+            return discard();
+        }
+        return diags.add(source, code, location);
+    }
+
+    if (it->second == DroppedDiag)
+        return discard();
+
+    // This is a duplicate. Prefer the copy issued from within a definition, since that's
+    // independent of any particular instance; otherwise keep whichever came first.
+    Diagnostic& existing = diags[it->second];
+    if (source.kind == SymbolKind::Definition && existing.symbol->kind != SymbolKind::Definition) {
+        existing = std::move(diag);
+        return existing;
+    }
+
+    return discard();
 }
 
 const NetType& Compilation::getDefaultNetType(const ModuleDeclarationSyntax& decl) const {
@@ -512,6 +658,101 @@ const PackedArrayType& Compilation::getType(bitwidth_t width, bitmask<IntegralFl
     return *type;
 }
 
+size_t Compilation::hashConstantCall(const SubroutineSymbol& subroutine,
+                                     span<const ConstantValue> args) {
+    size_t seed = std::hash<const SubroutineSymbol*>()(&subroutine);
+    for (auto& arg : args)
+        seed = arg.hash(seed);
+    return seed;
+}
+
+const ConstantValue* Compilation::findConstantCall(const SubroutineSymbol& subroutine,
+                                                   span<const ConstantValue> args) {
+    if (!options.memoizeConstantFunctions || frozen)
+        return nullptr;
+
+    auto it = constantCallCache.find(hashConstantCall(subroutine, args));
+    if (it != constantCallCache.end()) {
+        for (auto& entry : it->second) {
+            if (entry.subroutine != &subroutine)
+                continue;
+
+            bool match = true;
+            for (ptrdiff_t i = 0; i < args.size(); i++) {
+                if (!exactlyEqual(entry.args[size_t(i)], args[i])) {
+                    match = false;
+                    break;
+                }
+            }
+
+            if (match) {
+                constantCallStats.hits++;
+                return &entry.result;
+            }
+        }
+    }
+
+    constantCallStats.misses++;
+    return nullptr;
+}
+
+void Compilation::cacheConstantCall(const SubroutineSymbol& subroutine,
+                                    span<const ConstantValue> args, const ConstantValue& result) {
+    if (!options.memoizeConstantFunctions || frozen)
+        return;
+
+    CachedCall entry{ &subroutine, { args.begin(), args.end() }, result };
+    constantCallCache[hashConstantCall(subroutine, args)].emplace_back(std::move(entry));
+    constantCallStats.entries++;
+}
+
+ConstantFunctionCacheStats Compilation::getConstantFunctionCacheStats() const {
+    return constantCallStats;
+}
+
+const Expression* Compilation::findBoundExpression(const ExpressionSyntax& syntax,
+                                                   const Type* targetType,
+                                                   bitmask<BindFlags> flags) const {
+    auto it = boundExpressionCache.find(std::make_tuple(&syntax, targetType, flags.bits()));
+    if (it == boundExpressionCache.end())
+        return nullptr;
+    return it->second;
+}
+
+void Compilation::cacheBoundExpression(const ExpressionSyntax& syntax, const Type* targetType,
+                                       bitmask<BindFlags> flags, const Expression& expr) {
+    boundExpressionCache.emplace(std::make_tuple(&syntax, targetType, flags.bits()), &expr);
+}
+
+void Compilation::recordConstantCall(const ConstantCallProfile& sample) {
+    if (frozen)
+        return;
+
+    auto key = std::make_tuple(sample.subroutine, sample.callLocation);
+    auto it = constantCallProfiles.find(key);
+    if (it == constantCallProfiles.end()) {
+        constantCallProfiles.emplace(key, sample);
+        return;
+    }
+
+    ConstantCallProfile& profile = it->second;
+    profile.calls += sample.calls;
+    profile.expressions += sample.expressions;
+    profile.loopIterations += sample.loopIterations;
+    profile.time += sample.time;
+}
+
+std::vector<ConstantCallProfile> Compilation::getConstantCallProfile() const {
+    std::vector<ConstantCallProfile> results;
+    results.reserve(constantCallProfiles.size());
+    for (auto& [key, profile] : constantCallProfiles)
+        results.push_back(profile);
+
+    std::sort(results.begin(), results.end(),
+              [](auto& a, auto& b) { return a.time > b.time; });
+    return results;
+}
+
 const ScalarType& Compilation::getScalarType(bitmask<IntegralFlags> flags) {
     ScalarType* ptr = scalarTypeTable[flags.bits() & 0x7];
     ASSERT(ptr);
@@ -0,0 +1,467 @@
+//------------------------------------------------------------------------------
+// ConnectivityGraph.cpp
+// Design-wide graph of value drivers and loads.
+//
+// File is under the MIT license; see LICENSE for details.
+//------------------------------------------------------------------------------
+#include "slang/compilation/ConnectivityGraph.h"
+
+#include <istream>
+#include <ostream>
+#include <thread>
+
+#include "slang/binding/CompactExpression.h"
+#include "slang/symbols/HierarchySymbols.h"
+#include "slang/symbols/MemberSymbols.h"
+#include "slang/util/BinaryFormat.h"
+
+namespace {
+
+using namespace slang;
+
+// The file format is a fixed header, the node table (kind and path for each node),
+// and then the edge list. All integers are variable length encoded; ranges are
+// zigzag encoded so that negative bounds stay small.
+const BinaryFormat GraphFormat{ "SLANGNET", 1, "connectivity graph" };
+
+void writeRange(std::ostream& stream, ConstantRange range) {
+    for (int32_t bound : { range.left, range.right })
+        BinaryFormat::writeVarInt(stream, (uint32_t(bound) << 1) ^ uint32_t(bound >> 31));
+}
+
+uint32_t readIndex(std::istream& stream, size_t limit) {
+    uint64_t value = GraphFormat.readVarInt(stream);
+    if (value >= limit)
+        GraphFormat.malformed();
+    return uint32_t(value);
+}
+
+ConstantRange readRange(std::istream& stream) {
+    int32_t bounds[2];
+    for (auto& bound : bounds) {
+        auto value = uint32_t(GraphFormat.readVarInt(stream));
+        bound = int32_t((value >> 1) ^ -(value & 1));
+    }
+    return { bounds[0], bounds[1] };
+}
+
+bool isConnectable(const Symbol& symbol) {
+    return symbol.kind == SymbolKind::Net || symbol.kind == SymbolKind::Variable ||
+           symbol.kind == SymbolKind::Port;
+}
+
+ConstantRange normalize(ConstantRange range) {
+    return { range.upper(), range.lower() };
+}
+
+optional<int32_t> getConstantIndex(const Expression& expr) {
+    if (!expr.constant || !expr.constant->isInteger())
+        return std::nullopt;
+    return expr.constant->integer().as<int32_t>();
+}
+
+// Determines the part of a value covered by a select with constant bounds.
+optional<ConstantRange> getSelectRange(const Expression& expr) {
+    if (expr.kind == ExpressionKind::ElementSelect) {
+        auto index = getConstantIndex(expr.as<ElementSelectExpression>().selector());
+        if (!index)
+            return std::nullopt;
+        return ConstantRange{ *index, *index };
+    }
+
+    auto& select = expr.as<RangeSelectExpression>();
+    auto left = getConstantIndex(select.left());
+    auto right = getConstantIndex(select.right());
+    if (!left || !right)
+        return std::nullopt;
+
+    switch (select.selectionKind) {
+        case RangeSelectionKind::Simple:
+            return normalize({ *left, *right });
+        case RangeSelectionKind::IndexedUp:
+            return ConstantRange{ *left + *right - 1, *left };
+        case RangeSelectionKind::IndexedDown:
+            return ConstantRange{ *left, *left - *right + 1 };
+    }
+    THROW_UNREACHABLE;
+}
+
+struct ValueRef {
+    const ValueSymbol* symbol;
+    ConstantRange range;
+};
+
+ValueRef getWholeValue(const ValueSymbol& symbol) {
+    return { &symbol, normalize(symbol.getType().getArrayRange()) };
+}
+
+// Finds all of the values referenced by the given encoded expression. Values being
+// written go into targets and values being read go into sources; only the lvalue
+// parts of the expression can produce targets, since any index expressions beneath
+// them are always read.
+void collectRefs(const CompactExpressionSet& set, uint32_t index, bool isTarget,
+                 SmallVector<ValueRef>& targets, SmallVector<ValueRef>& sources) {
+    auto& node = set[index];
+    auto children = set.children(node);
+    auto& refs = isTarget ? targets : sources;
+
+    switch (node.kind) {
+        case ExpressionKind::NamedValue: {
+            auto& symbol = node.expr->as<NamedValueExpression>().symbol;
+            if (isConnectable(symbol))
+                refs.append(getWholeValue(symbol));
+            return;
+        }
+        case ExpressionKind::ElementSelect:
+        case ExpressionKind::RangeSelect: {
+            auto& value = set[children[0]];
+            auto range = getSelectRange(*node.expr);
+            if (value.kind == ExpressionKind::NamedValue && range) {
+                auto& symbol = value.expr->as<NamedValueExpression>().symbol;
+                if (isConnectable(symbol))
+                    refs.append({ &symbol, *range });
+            }
+            else {
+                collectRefs(set, children[0], isTarget, targets, sources);
+            }
+
+            for (auto child : children.subspan(1))
+                collectRefs(set, child, false, targets, sources);
+            return;
+        }
+        case ExpressionKind::Concatenation:
+        case ExpressionKind::MemberAccess:
+        case ExpressionKind::Conversion:
+            for (auto child : children)
+                collectRefs(set, child, isTarget, targets, sources);
+            return;
+        default:
+            for (auto child : children)
+                collectRefs(set, child, false, targets, sources);
+            return;
+    }
+}
+
+// A single connection found while walking the hierarchy. Each side is either
+// an expression or a value that's connected directly as a whole.
+struct Connection {
+    const Expression* targetExpr = nullptr;
+    ValueRef targetValue{};
+    const Expression* sourceExpr = nullptr;
+    ValueRef sourceValue{};
+    ConnectivityGraph::EdgeKind kind;
+};
+
+struct PendingEdge {
+    ValueRef source;
+    ValueRef target;
+    ConnectivityGraph::EdgeKind kind;
+};
+
+} // namespace
+
+namespace slang {
+
+class ConnectivityGraph::Builder {
+public:
+    explicit Builder(ConnectivityGraph& graph) : graph(graph) {}
+
+    void visitScope(const Scope& scope) {
+        for (auto& member : scope.members()) {
+            switch (member.kind) {
+                case SymbolKind::Net:
+                case SymbolKind::Variable:
+                    getNode(member.as<ValueSymbol>());
+                    break;
+                case SymbolKind::Port:
+                    addPort(member.as<PortSymbol>());
+                    break;
+                case SymbolKind::ContinuousAssign: {
+                    auto& assign = member.as<ContinuousAssignSymbol>().getAssignment();
+                    if (assign.kind == ExpressionKind::Assignment) {
+                        auto& expr = assign.as<AssignmentExpression>();
+                        Connection conn;
+                        conn.targetExpr = &expr.left();
+                        conn.sourceExpr = &expr.right();
+                        conn.kind = EdgeKind::Assign;
+                        connections.push_back(conn);
+                    }
+                    break;
+                }
+                case SymbolKind::ModuleInstance:
+                case SymbolKind::InterfaceInstance:
+                case SymbolKind::InstanceArray:
+                case SymbolKind::GenerateBlockArray:
+                    visitScope(member.as<Scope>());
+                    break;
+                case SymbolKind::GenerateBlock:
+                    if (member.as<GenerateBlockSymbol>().isInstantiated)
+                        visitScope(member.as<Scope>());
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+    // Scans all of the connections that were found, splitting the work across
+    // the given number of threads, and adds the resulting edges to the graph.
+    void addEdges(uint32_t numThreads) {
+        numThreads = std::max(numThreads, 1u);
+        size_t chunkSize = (connections.size() + numThreads - 1) / numThreads;
+
+        std::vector<std::vector<PendingEdge>> results(numThreads);
+        auto scanChunk = [&](size_t chunk) {
+            size_t begin = std::min(chunk * chunkSize, connections.size());
+            size_t end = std::min(begin + chunkSize, connections.size());
+            scan(span<const Connection>(connections.data() + begin, end - begin),
+                 results[chunk]);
+        };
+
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < numThreads; i++)
+            threads.emplace_back(scanChunk, i);
+
+        scanChunk(0);
+        for (auto& thread : threads)
+            thread.join();
+
+        for (auto& result : results) {
+            for (auto& pending : result) {
+                Edge edge;
+                edge.source = getNode(*pending.source.symbol);
+                edge.target = getNode(*pending.target.symbol);
+                edge.sourceRange = pending.source.range;
+                edge.targetRange = pending.target.range;
+                edge.kind = pending.kind;
+                graph.edges_.push_back(edge);
+            }
+        }
+    }
+
+private:
+    uint32_t getNode(const ValueSymbol& symbol) {
+        auto it = graph.symbolMap.find(&symbol);
+        if (it != graph.symbolMap.end())
+            return it->second;
+
+        pathBuffer.clear();
+        symbol.getHierarchicalPath(pathBuffer);
+        return graph.addNode(&symbol, symbol.kind, pathBuffer);
+    }
+
+    void addPort(const PortSymbol& port) {
+        // Ports always connect straight through to their internal value, if
+        // there is one, so the port symbol itself is only used as a node
+        // when nothing else is available.
+        const ValueSymbol* internalSymbol = &port;
+        const Expression* internalExpr = nullptr;
+        if (port.internalSymbol && isConnectable(*port.internalSymbol))
+            internalSymbol = &port.internalSymbol->as<ValueSymbol>();
+        else if (port.internalConnection)
+            internalExpr = port.internalConnection;
+
+        if (!internalExpr)
+            getNode(*internalSymbol);
+
+        auto externalExpr = port.getExternalConnection();
+        if (!externalExpr)
+            return;
+
+        // Types are resolved lazily, so get the range of the internal value
+        // here instead of leaving it for the scanning threads.
+        ValueRef internalValue{};
+        if (!internalExpr)
+            internalValue = getWholeValue(*internalSymbol);
+
+        Connection conn;
+        conn.kind = EdgeKind::Port;
+        if (port.direction != PortDirection::Out) {
+            conn.targetExpr = internalExpr;
+            conn.targetValue = internalValue;
+            conn.sourceExpr = externalExpr;
+            connections.push_back(conn);
+        }
+
+        if (port.direction != PortDirection::In) {
+            conn.targetExpr = externalExpr;
+            conn.targetValue = {};
+            conn.sourceExpr = internalExpr;
+            conn.sourceValue = internalValue;
+            connections.push_back(conn);
+        }
+    }
+
+    void scan(span<const Connection> chunk, std::vector<PendingEdge>& results) {
+        // Only symbols and already bound expressions are touched here, so this is
+        // safe to run concurrently with other chunks.
+        CompactExpressionSet set;
+        SmallVectorSized<ValueRef, 8> targets;
+        SmallVectorSized<ValueRef, 8> sources;
+
+        auto collect = [&](const Expression* expr, const ValueRef& value, bool isTarget) {
+            if (expr)
+                collectRefs(set, set.add(*expr), isTarget, targets, sources);
+            else
+                (isTarget ? targets : sources).append(value);
+        };
+
+        for (auto& conn : chunk) {
+            targets.clear();
+            sources.clear();
+            collect(conn.targetExpr, conn.targetValue, true);
+            collect(conn.sourceExpr, conn.sourceValue, false);
+
+            for (auto& target : targets) {
+                for (auto& source : sources)
+                    results.push_back({ source, target, conn.kind });
+            }
+        }
+    }
+
+    ConnectivityGraph& graph;
+    std::vector<Connection> connections;
+    std::string pathBuffer;
+};
+
+ConnectivityGraph ConnectivityGraph::build(const RootSymbol& root, uint32_t numThreads) {
+    // Walking the hierarchy forces elaboration and the binding of connection
+    // expressions, neither of which is thread safe, so that part is done up front.
+    ConnectivityGraph graph;
+    Builder builder(graph);
+    for (auto instance : root.topInstances)
+        builder.visitScope(*instance);
+
+    builder.addEdges(numThreads);
+    graph.finalize();
+    return graph;
+}
+
+ConnectivityGraph ConnectivityGraph::load(std::istream& stream) {
+    GraphFormat.readHeader(stream);
+
+    ConnectivityGraph graph;
+    std::string path;
+    uint64_t numNodes = GraphFormat.readVarInt(stream);
+    for (uint64_t i = 0; i < numNodes; i++) {
+        auto kind = SymbolKind(GraphFormat.readVarInt(stream));
+        path.resize(GraphFormat.readVarInt(stream));
+        if (!stream.read(path.data(), std::streamsize(path.size())))
+            GraphFormat.malformed();
+
+        graph.addNode(nullptr, kind, path);
+    }
+
+    uint64_t numEdges = GraphFormat.readVarInt(stream);
+    for (uint64_t i = 0; i < numEdges; i++) {
+        Edge edge;
+        edge.source = readIndex(stream, numNodes);
+        edge.target = readIndex(stream, numNodes);
+        edge.kind = EdgeKind(readIndex(stream, uint64_t(EdgeKind::Port) + 1));
+        edge.sourceRange = readRange(stream);
+        edge.targetRange = readRange(stream);
+        graph.edges_.push_back(edge);
+    }
+
+    graph.symbols.clear();
+    graph.finalize();
+    return graph;
+}
+
+void ConnectivityGraph::save(std::ostream& stream) const {
+    GraphFormat.writeHeader(stream);
+
+    BinaryFormat::writeVarInt(stream, numNodes());
+    for (uint32_t i = 0; i < numNodes(); i++) {
+        string_view path = getPath(i);
+        BinaryFormat::writeVarInt(stream, uint64_t(kinds[i]));
+        BinaryFormat::writeVarInt(stream, path.size());
+        stream.write(path.data(), std::streamsize(path.size()));
+    }
+
+    BinaryFormat::writeVarInt(stream, edges_.size());
+    for (auto& edge : edges_) {
+        BinaryFormat::writeVarInt(stream, edge.source);
+        BinaryFormat::writeVarInt(stream, edge.target);
+        BinaryFormat::writeVarInt(stream, uint64_t(edge.kind));
+        writeRange(stream, edge.sourceRange);
+        writeRange(stream, edge.targetRange);
+    }
+}
+
+string_view ConnectivityGraph::getPath(uint32_t node) const {
+    return string_view(pathData.data() + pathOffsets[node],
+                       pathOffsets[node + 1] - pathOffsets[node]);
+}
+
+optional<uint32_t> ConnectivityGraph::findNode(const ValueSymbol& symbol) const {
+    auto it = symbolMap.find(&symbol);
+    if (it == symbolMap.end())
+        return std::nullopt;
+    return it->second;
+}
+
+optional<uint32_t> ConnectivityGraph::findNode(string_view path) const {
+    auto it = pathMap.find(path);
+    if (it == pathMap.end())
+        return std::nullopt;
+    return it->second;
+}
+
+span<const ConnectivityGraph::Edge> ConnectivityGraph::getDrivers(uint32_t node) const {
+    return span<const Edge>(edges_.data() + driverOffsets[node],
+                            driverOffsets[node + 1] - driverOffsets[node]);
+}
+
+span<const uint32_t> ConnectivityGraph::getLoads(uint32_t node) const {
+    return span<const uint32_t>(loadEdges.data() + loadOffsets[node],
+                                loadOffsets[node + 1] - loadOffsets[node]);
+}
+
+uint32_t ConnectivityGraph::addNode(const ValueSymbol* symbol, SymbolKind kind,
+                                    string_view path) {
+    uint32_t node = uint32_t(kinds.size());
+    if (symbol)
+        symbolMap.emplace(symbol, node);
+
+    symbols.push_back(symbol);
+    kinds.push_back(kind);
+    pathData.append(path.data(), path.size());
+    pathOffsets.push_back(uint32_t(pathData.size()));
+    return node;
+}
+
+void ConnectivityGraph::finalize() {
+    // Sort the edges by target with a counting sort, which gives the driver offsets
+    // directly, and then do the same by source to build the list of loads.
+    size_t n = numNodes();
+    driverOffsets.assign(n + 1, 0);
+    loadOffsets.assign(n + 1, 0);
+    for (auto& edge : edges_) {
+        driverOffsets[edge.target + 1]++;
+        loadOffsets[edge.source + 1]++;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        driverOffsets[i + 1] += driverOffsets[i];
+        loadOffsets[i + 1] += loadOffsets[i];
+    }
+
+    std::vector<Edge> sorted(edges_.size());
+    std::vector<uint32_t> next(driverOffsets.begin(), driverOffsets.end() - 1);
+    for (auto& edge : edges_)
+        sorted[next[edge.target]++] = edge;
+    edges_ = std::move(sorted);
+
+    loadEdges.resize(edges_.size());
+    next.assign(loadOffsets.begin(), loadOffsets.end() - 1);
+    for (uint32_t i = 0; i < edges_.size(); i++)
+        loadEdges[next[edges_[i].source]++] = i;
+
+    pathMap.clear();
+    pathMap.reserve(n);
+    for (uint32_t i = 0; i < n; i++)
+        pathMap.emplace(getPath(i), i);
+}
+
+} // namespace slang
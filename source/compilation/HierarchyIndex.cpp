@@ -0,0 +1,372 @@
+//------------------------------------------------------------------------------
+// HierarchyIndex.cpp
+// Index of full hierarchical paths in an elaborated design.
+//
+// File is under the MIT license; see LICENSE for details.
+//------------------------------------------------------------------------------
+#include "slang/compilation/HierarchyIndex.h"
+
+#include <algorithm>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+
+#include "slang/symbols/HierarchySymbols.h"
+#include "slang/util/BinaryFormat.h"
+#include "slang/util/Hash.h"
+
+namespace {
+
+using namespace slang;
+
+// The index is used in place once loaded, so it has a fixed layout header instead
+// of the usual variable length one; see Header.
+const BinaryFormat IndexFormat{ "SLANGIDX", 1, "hierarchy index" };
+
+// The hash is part of the on-disk format, so it has to be stable across
+// processes and platforms.
+uint64_t hashPath(string_view path) {
+    return fnv1a64(path.data(), path.size());
+}
+
+bool startsWith(string_view text, string_view prefix) {
+    return text.substr(0, prefix.size()) == prefix;
+}
+
+bool globMatch(string_view pattern, string_view text) {
+    while (!pattern.empty()) {
+        char c = pattern[0];
+        if (c == '*') {
+            bool crossesScopes = pattern.size() > 1 && pattern[1] == '*';
+            pattern.remove_prefix(crossesScopes ? 2 : 1);
+            for (size_t i = 0; i <= text.size(); i++) {
+                if (globMatch(pattern, text.substr(i)))
+                    return true;
+                if (i < text.size() && text[i] == '.' && !crossesScopes)
+                    return false;
+            }
+            return false;
+        }
+
+        if (text.empty() || (c == '?' ? text[0] == '.' : c != text[0]))
+            return false;
+
+        pattern.remove_prefix(1);
+        text.remove_prefix(1);
+    }
+    return text.empty();
+}
+
+bool isHierarchyScope(const Symbol& symbol) {
+    switch (symbol.kind) {
+        case SymbolKind::ModuleInstance:
+        case SymbolKind::InterfaceInstance:
+        case SymbolKind::InstanceArray:
+        case SymbolKind::GenerateBlockArray:
+        case SymbolKind::GenerateBlock:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Collects paths for every symbol in the hierarchy, in visitation order.
+class PathCollector {
+public:
+    std::string pathData;
+    std::vector<uint32_t> pathOffsets{ 0 };
+    std::vector<const Symbol*> symbols;
+    std::vector<uint32_t> parents;
+
+    void visitTop(const InstanceSymbol& instance) {
+        std::string path(instance.name);
+        visitScope(instance, add(instance, path, UINT32_MAX), path);
+    }
+
+    string_view getPath(uint32_t index) const {
+        return string_view(pathData.data() + pathOffsets[index],
+                           pathOffsets[index + 1] - pathOffsets[index]);
+    }
+
+private:
+    uint32_t add(const Symbol& symbol, const std::string& path, uint32_t parent) {
+        pathData += path;
+        pathOffsets.push_back(uint32_t(pathData.size()));
+        symbols.push_back(&symbol);
+        parents.push_back(parent);
+        return uint32_t(symbols.size() - 1);
+    }
+
+    void visitScope(const Scope& scope, uint32_t scopeIndex, const std::string& scopePath) {
+        std::string path;
+        for (auto& member : scope.members()) {
+            switch (member.kind) {
+                case SymbolKind::TransparentMember:
+                case SymbolKind::ExplicitImport:
+                case SymbolKind::WildcardImport:
+                    continue;
+                case SymbolKind::GenerateBlock:
+                    if (!member.as<GenerateBlockSymbol>().isInstantiated)
+                        continue;
+                    break;
+                default:
+                    break;
+            }
+
+            bool isScope = isHierarchyScope(member);
+            if (member.name.empty() && !isScope)
+                continue;
+
+            // Some members share a name with an earlier one (ports and the values
+            // they connect to, for example); index whichever one lookup would find.
+            if (!member.name.empty() && scope.find(member.name) != &member)
+                continue;
+
+            if (member.name.empty()) {
+                path.clear();
+                member.getHierarchicalPath(path);
+            }
+            else {
+                path = scopePath;
+                path += '.';
+                path += member.name;
+            }
+
+            uint32_t index = add(member, path, scopeIndex);
+            if (isScope)
+                visitScope(member.as<Scope>(), index, path);
+        }
+    }
+};
+
+} // namespace
+
+namespace slang {
+
+HierarchyIndex HierarchyIndex::build(const RootSymbol& root) {
+    PathCollector collector;
+    for (auto instance : root.topInstances)
+        collector.visitTop(*instance);
+
+    // Sort everything by path; the sort is stable so that if there are ever
+    // any duplicate paths, the first one visited is the one that gets found.
+    uint32_t numEntries = uint32_t(collector.symbols.size());
+    std::vector<uint32_t> order(numEntries);
+    for (uint32_t i = 0; i < numEntries; i++)
+        order[i] = i;
+
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        return collector.getPath(a) < collector.getPath(b);
+    });
+
+    std::vector<uint32_t> sortedIndex(numEntries);
+    for (uint32_t i = 0; i < numEntries; i++)
+        sortedIndex[order[i]] = i;
+
+    // Keep the load factor at or below one half so probe sequences stay short.
+    uint32_t numBuckets = 16;
+    while (numBuckets < numEntries * 2)
+        numBuckets *= 2;
+
+    size_t imageSize = sizeof(Header) + numEntries * sizeof(Entry) +
+                       numBuckets * sizeof(uint32_t) + collector.pathData.size();
+
+    HierarchyIndex index;
+    index.ownedData.resize((imageSize + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+    char* image = reinterpret_cast<char*>(index.ownedData.data());
+
+    Header header;
+    memcpy(header.magic, IndexFormat.magic.data(), sizeof(header.magic));
+    header.version = uint32_t(IndexFormat.version);
+    header.numEntries = numEntries;
+    header.numBuckets = numBuckets;
+    header.stringDataSize = uint32_t(collector.pathData.size());
+    memcpy(image, &header, sizeof(Header));
+
+    auto entries = reinterpret_cast<Entry*>(image + sizeof(Header));
+    auto buckets = reinterpret_cast<uint32_t*>(entries + numEntries);
+    auto strings = reinterpret_cast<char*>(buckets + numBuckets);
+    std::fill(buckets, buckets + numBuckets, NoEntry);
+
+    uint32_t stringOffset = 0;
+    index.symbols.reserve(numEntries);
+    for (uint32_t i = 0; i < numEntries; i++) {
+        uint32_t original = order[i];
+        string_view path = collector.getPath(original);
+        memcpy(strings + stringOffset, path.data(), path.size());
+
+        Entry& entry = entries[i];
+        entry.hash = hashPath(path);
+        entry.pathOffset = stringOffset;
+        entry.pathLength = uint32_t(path.size());
+        entry.kind = uint32_t(collector.symbols[original]->kind);
+        entry.parent = collector.parents[original] == UINT32_MAX
+                           ? NoEntry
+                           : sortedIndex[collector.parents[original]];
+
+        stringOffset += entry.pathLength;
+        index.symbols.push_back(collector.symbols[original]);
+
+        uint32_t slot = uint32_t(entry.hash) & (numBuckets - 1);
+        while (buckets[slot] != NoEntry) {
+            if (collector.getPath(order[buckets[slot]]) == path)
+                break;
+            slot = (slot + 1) & (numBuckets - 1);
+        }
+
+        if (buckets[slot] == NoEntry)
+            buckets[slot] = i;
+    }
+
+    index.data = span<const char>(image, ptrdiff_t(imageSize));
+    return index;
+}
+
+HierarchyIndex HierarchyIndex::load(std::istream& stream) {
+    Header header;
+    if (!stream.read(reinterpret_cast<char*>(&header), sizeof(Header)) ||
+        memcmp(header.magic, IndexFormat.magic.data(), sizeof(header.magic)) != 0) {
+        IndexFormat.wrongFormat();
+    }
+
+    uint64_t imageSize = sizeof(Header) + uint64_t(header.numEntries) * sizeof(Entry) +
+                         uint64_t(header.numBuckets) * sizeof(uint32_t) +
+                         header.stringDataSize;
+
+    HierarchyIndex index;
+    index.ownedData.resize(size_t((imageSize + sizeof(uint64_t) - 1) / sizeof(uint64_t)));
+
+    char* image = reinterpret_cast<char*>(index.ownedData.data());
+    memcpy(image, &header, sizeof(Header));
+    if (!stream.read(image + sizeof(Header), std::streamsize(imageSize - sizeof(Header))))
+        IndexFormat.malformed();
+
+    index.setData(span<const char>(image, ptrdiff_t(imageSize)));
+    return index;
+}
+
+HierarchyIndex HierarchyIndex::fromBuffer(span<const char> data) {
+    HierarchyIndex index;
+    index.setData(data);
+    return index;
+}
+
+void HierarchyIndex::save(std::ostream& stream) const {
+    stream.write(data.data(), std::streamsize(data.size()));
+}
+
+optional<uint32_t> HierarchyIndex::find(string_view path) const {
+    uint64_t hash = hashPath(path);
+    uint32_t mask = header().numBuckets - 1;
+    auto table = buckets();
+    auto list = entries();
+
+    for (uint32_t slot = uint32_t(hash) & mask;; slot = (slot + 1) & mask) {
+        uint32_t entry = table[slot];
+        if (entry == NoEntry)
+            return std::nullopt;
+
+        if (list[entry].hash == hash && getPath(entry) == path)
+            return entry;
+    }
+}
+
+void HierarchyIndex::find(span<const string_view> paths,
+                          SmallVector<optional<uint32_t>>& results) const {
+    for (auto path : paths)
+        results.append(find(path));
+}
+
+std::pair<uint32_t, uint32_t> HierarchyIndex::findPrefix(string_view prefix) const {
+    // Paths with the given prefix sort directly after the prefix itself
+    // and are all contiguous, so two binary searches find the range.
+    auto partition = [this](uint32_t first, auto&& predicate) {
+        uint32_t last = size();
+        while (first < last) {
+            uint32_t mid = first + (last - first) / 2;
+            if (predicate(getPath(mid)))
+                first = mid + 1;
+            else
+                last = mid;
+        }
+        return first;
+    };
+
+    uint32_t begin = partition(0, [&](string_view path) { return path < prefix; });
+    uint32_t end = partition(begin,
+                             [&](string_view path) { return startsWith(path, prefix); });
+    return { begin, end };
+}
+
+void HierarchyIndex::glob(string_view pattern, SmallVector<uint32_t>& results) const {
+    // Only entries starting with the literal part of the pattern can match.
+    auto [begin, end] = findPrefix(pattern.substr(0, pattern.find_first_of("*?")));
+    for (uint32_t i = begin; i < end; i++) {
+        if (globMatch(pattern, getPath(i)))
+            results.append(i);
+    }
+}
+
+string_view HierarchyIndex::getPath(uint32_t entry) const {
+    auto& e = entries()[entry];
+    return string_view(stringData() + e.pathOffset, e.pathLength);
+}
+
+optional<uint32_t> HierarchyIndex::getParent(uint32_t entry) const {
+    uint32_t parent = entries()[entry].parent;
+    if (parent == NoEntry)
+        return std::nullopt;
+    return parent;
+}
+
+void HierarchyIndex::setData(span<const char> newData) {
+    // Everything is validated up front, so that queries don't have to
+    // check anything even when the data came from somewhere untrusted.
+    size_t size = size_t(newData.size());
+    if (size < sizeof(Header) ||
+        memcmp(newData.data(), IndexFormat.magic.data(), sizeof(Header::magic)) != 0) {
+        IndexFormat.wrongFormat();
+    }
+
+    if (uintptr_t(newData.data()) % alignof(Entry) != 0)
+        throw std::runtime_error("Hierarchy index data is not aligned");
+
+    data = newData;
+    auto& h = header();
+    if (h.version != IndexFormat.version)
+        IndexFormat.wrongVersion();
+
+    uint64_t expected = sizeof(Header) + uint64_t(h.numEntries) * sizeof(Entry) +
+                        uint64_t(h.numBuckets) * sizeof(uint32_t) + h.stringDataSize;
+    if (expected > size || h.numBuckets <= h.numEntries ||
+        (h.numBuckets & (h.numBuckets - 1)) != 0) {
+        IndexFormat.malformed();
+    }
+
+    // findPrefix relies on the entries being sorted by path.
+    auto list = entries();
+    for (uint32_t i = 0; i < h.numEntries; i++) {
+        auto& e = list[i];
+        if (uint64_t(e.pathOffset) + e.pathLength > h.stringDataSize ||
+            (e.parent != NoEntry && e.parent >= h.numEntries) ||
+            (i > 0 && getPath(i - 1) >= getPath(i))) {
+            IndexFormat.malformed();
+        }
+    }
+
+    // find() probes until it hits an empty bucket, so there must be one.
+    auto table = buckets();
+    bool anyEmpty = false;
+    for (uint32_t i = 0; i < h.numBuckets; i++) {
+        if (table[i] == NoEntry)
+            anyEmpty = true;
+        else if (table[i] >= h.numEntries)
+            IndexFormat.malformed();
+    }
+
+    if (!anyEmpty)
+        IndexFormat.malformed();
+}
+
+} // namespace slang
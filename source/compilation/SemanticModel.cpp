@@ -6,7 +6,200 @@
 //------------------------------------------------------------------------------
 #include "slang/compilation/SemanticModel.h"
 
+#include <algorithm>
+
+#include "slang/binding/CompactExpression.h"
+#include "slang/binding/Statements.h"
 #include "slang/compilation/Compilation.h"
+#include "slang/text/SourceManager.h"
+
+namespace {
+
+using namespace slang;
+using SymbolSpan = SemanticModel::SymbolSpan;
+
+const Statement* getBody(const Symbol& symbol) {
+    switch (symbol.kind) {
+        case SymbolKind::ProceduralBlock:
+            return symbol.as<ProceduralBlockSymbol>().getBody();
+        case SymbolKind::SequentialBlock:
+            return symbol.as<SequentialBlockSymbol>().getBody();
+        case SymbolKind::Subroutine:
+            return symbol.as<SubroutineSymbol>().getBody();
+        default:
+            return nullptr;
+    }
+}
+
+// Collects the spans of every declaration and reference beneath a scope.
+class SpanCollector {
+public:
+    flat_hash_map<BufferID, std::vector<SymbolSpan>> spans;
+
+    SpanCollector(const SourceManager& sourceManager,
+                  flat_hash_map<const SyntaxNode*, const Symbol*>& symbolCache) :
+        sourceManager(sourceManager),
+        symbolCache(symbolCache) {}
+
+    void visitScope(const Scope& scope) {
+        for (auto& member : scope.members())
+            visitMember(member);
+    }
+
+    // References from expressions are gathered up as we go and then
+    // all scanned at once here, in one pass over the encoded nodes.
+    void finish() {
+        for (auto& node : expressions) {
+            switch (node.kind) {
+                case ExpressionKind::NamedValue:
+                    add(node.expr->sourceRange, node.expr->as<NamedValueExpression>().symbol,
+                        false);
+                    break;
+                case ExpressionKind::Call: {
+                    auto& call = node.expr->as<CallExpression>();
+                    const SyntaxNode* syntax = call.syntax;
+                    if (call.isSystemCall() || !syntax)
+                        break;
+
+                    // Only the subroutine name refers to the subroutine, not the arguments.
+                    if (syntax->kind == SyntaxKind::InvocationExpression)
+                        syntax = syntax->as<InvocationExpressionSyntax>().left;
+                    add(syntax->sourceRange(), *std::get<0>(call.subroutine), false);
+                    break;
+                }
+                default:
+                    break;
+            }
+        }
+    }
+
+private:
+    void add(SourceRange range, const Symbol& symbol, bool isDeclaration) {
+        SourceLocation start = range.start();
+        if (!start || !sourceManager.isFileLoc(start) || range.end().buffer() != start.buffer())
+            return;
+
+        spans[start.buffer()].push_back(
+            { start.offset(), range.end().offset(), &symbol, isDeclaration });
+    }
+
+    void addDeclaration(const Symbol& symbol) {
+        add(SourceRange(symbol.location, symbol.location + symbol.name.length()), symbol, true);
+        if (auto syntax = symbol.getSyntax())
+            symbolCache.emplace(syntax, &symbol);
+    }
+
+    void visitMember(const Symbol& symbol) {
+        switch (symbol.kind) {
+            case SymbolKind::TransparentMember:
+            case SymbolKind::ExplicitImport:
+            case SymbolKind::WildcardImport:
+                return;
+            case SymbolKind::ModuleInstance:
+            case SymbolKind::InterfaceInstance:
+                visitInstance(symbol.as<InstanceSymbol>());
+                return;
+            case SymbolKind::ContinuousAssign:
+                expressions.add(symbol.as<ContinuousAssignSymbol>().getAssignment());
+                return;
+            default:
+                break;
+        }
+
+        if (!symbol.name.empty())
+            addDeclaration(symbol);
+
+        if (auto declaredType = symbol.getDeclaredType()) {
+            // Enum values have the enum as their type; don't go around in circles.
+            visitDeclaredType(*declaredType, symbol.kind != SymbolKind::EnumValue);
+        }
+
+        if (symbol.isScope()) {
+            visitScope(symbol.as<Scope>());
+            if (auto body = getBody(symbol))
+                visitStatement(*body);
+        }
+    }
+
+    void visitDeclaredType(const DeclaredType& declaredType, bool visitEnums) {
+        auto& type = declaredType.getType();
+        auto typeSyntax = declaredType.getTypeSyntax();
+        if (typeSyntax && typeSyntax->kind == SyntaxKind::NamedType &&
+            type.kind == SymbolKind::TypeAlias) {
+            add(typeSyntax->sourceRange(), type, false);
+        }
+        else if (visitEnums && type.kind == SymbolKind::EnumType) {
+            visitScope(type.as<EnumType>());
+        }
+
+        if (auto initializer = declaredType.getInitializer())
+            expressions.add(*initializer);
+    }
+
+    void visitInstance(const InstanceSymbol& instance) {
+        if (!instance.name.empty())
+            addDeclaration(instance);
+
+        for (auto syntax = instance.getSyntax(); syntax; syntax = syntax->parent) {
+            if (syntax->kind == SyntaxKind::HierarchyInstantiation) {
+                add(syntax->as<HierarchyInstantiationSyntax>().type.range(), instance.definition,
+                    false);
+                break;
+            }
+        }
+
+        // Everything else in the instance belongs to its definition; only
+        // the port connections are written in the instantiating scope.
+        for (auto& port : instance.membersOfType<PortSymbol>()) {
+            if (auto connection = port.getExternalConnection())
+                expressions.add(*connection);
+        }
+    }
+
+    void visitStatement(const Statement& statement) {
+        switch (statement.kind) {
+            case StatementKind::List:
+                for (auto item : statement.as<StatementList>().list)
+                    visitStatement(*item);
+                break;
+            case StatementKind::Return:
+                if (auto expr = statement.as<ReturnStatement>().expr)
+                    expressions.add(*expr);
+                break;
+            case StatementKind::Conditional: {
+                auto& conditional = statement.as<ConditionalStatement>();
+                expressions.add(conditional.cond);
+                visitStatement(conditional.ifTrue);
+                if (conditional.ifFalse)
+                    visitStatement(*conditional.ifFalse);
+                break;
+            }
+            case StatementKind::ForLoop: {
+                auto& loop = statement.as<ForLoopStatement>();
+                visitStatement(loop.initializers);
+                if (loop.stopExpr)
+                    expressions.add(*loop.stopExpr);
+                for (auto step : loop.steps)
+                    expressions.add(*step);
+                visitStatement(loop.body);
+                break;
+            }
+            case StatementKind::ExpressionStatement:
+                expressions.add(statement.as<ExpressionStatement>().expr);
+                break;
+            default:
+                // Blocks and declared variables are members of the enclosing
+                // scope, so they've already been visited as such.
+                break;
+        }
+    }
+
+    const SourceManager& sourceManager;
+    flat_hash_map<const SyntaxNode*, const Symbol*>& symbolCache;
+    CompactExpressionSet expressions;
+};
+
+} // namespace
 
 namespace slang {
 
@@ -109,4 +302,78 @@ const TypeAliasType* SemanticModel::getDeclaredSymbol(const TypedefDeclarationSy
     return result ? &result->as<TypeAliasType>() : nullptr;
 }
 
+void SemanticModel::indexCompilationUnit(const CompilationUnitSyntax& syntax) {
+    auto unit = getDeclaredSymbol(syntax);
+    if (!unit)
+        return;
+
+    SpanCollector collector(*compilation.getSourceManager(), symbolCache);
+    collector.visitScope(*unit);
+    collector.finish();
+
+    for (auto& [buffer, spans] : collector.spans) {
+        auto& index = fileIndices[buffer];
+        index.spans.insert(index.spans.end(), spans.begin(), spans.end());
+
+        std::sort(index.spans.begin(), index.spans.end(),
+                  [](const SymbolSpan& a, const SymbolSpan& b) {
+                      if (a.start != b.start)
+                          return a.start < b.start;
+                      if (a.end != b.end)
+                          return a.end > b.end;
+                      return a.isDeclaration > b.isDeclaration;
+                  });
+
+        // The same name can be reached more than once, through each element of an
+        // instance array for example, or by indexing the same file twice.
+        auto last = std::unique(index.spans.begin(), index.spans.end(),
+                                [](const SymbolSpan& a, const SymbolSpan& b) {
+                                    return a.start == b.start && a.end == b.end &&
+                                           a.isDeclaration == b.isDeclaration;
+                                });
+        index.spans.erase(last, index.spans.end());
+
+        index.maxEnds.resize(index.spans.size());
+        uint32_t maxEnd = 0;
+        for (size_t i = 0; i < index.spans.size(); i++) {
+            maxEnd = std::max(maxEnd, index.spans[i].end);
+            index.maxEnds[i] = maxEnd;
+        }
+    }
+}
+
+const SemanticModel::SymbolSpan* SemanticModel::findSpan(SourceLocation location) const {
+    auto it = fileIndices.find(location.buffer());
+    if (it == fileIndices.end())
+        return nullptr;
+
+    // Start from the last span beginning at or before the location and work backwards;
+    // the first one that covers the location is the innermost one.
+    auto& index = it->second;
+    uint32_t offset = location.offset();
+    auto first = std::upper_bound(
+        index.spans.begin(), index.spans.end(), offset,
+        [](uint32_t offset, const SymbolSpan& span) { return offset < span.start; });
+
+    for (size_t i = size_t(first - index.spans.begin()); i > 0; i--) {
+        if (index.maxEnds[i - 1] <= offset)
+            break;
+        if (index.spans[i - 1].end > offset)
+            return &index.spans[i - 1];
+    }
+    return nullptr;
+}
+
+const Symbol* SemanticModel::getSymbolAt(SourceLocation location) const {
+    auto result = findSpan(location);
+    return result ? result->symbol : nullptr;
+}
+
+span<const SemanticModel::SymbolSpan> SemanticModel::getSpans(BufferID buffer) const {
+    auto it = fileIndices.find(buffer);
+    if (it == fileIndices.end())
+        return {};
+    return it->second.spans;
+}
+
 } // namespace slang
\ No newline at end of file
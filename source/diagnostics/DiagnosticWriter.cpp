@@ -6,7 +6,9 @@
 //------------------------------------------------------------------------------
 #include "slang/diagnostics/DiagnosticWriter.h"
 
+#include <condition_variable>
 #include <fmt/ostream.h>
+#include <thread>
 
 #include "slang/text/FormatBuffer.h"
 #include "slang/text/SourceManager.h"
@@ -222,27 +224,142 @@ std::string DiagnosticWriter::report(const Diagnostic& diagnostic) {
 }
 
 std::string DiagnosticWriter::report(const Diagnostics& diagnostics) {
-    std::deque<SourceLocation> includeStack;
-    BufferID lastBuffer;
-    FormatBuffer buffer;
+    std::string result;
+    report(diagnostics, [&](std::string&& text) { result += text; });
+    return result;
+}
+
+void DiagnosticWriter::report(const Diagnostics& diagnostics, const Sink& sink,
+                              uint32_t numThreads) {
+    // Diagnostics are rendered in fixed size chunks so that the amount of text we hold
+    // onto at any one time stays bounded, no matter how many diagnostics there are.
+    const size_t ChunkSize = 256;
+    span<const Diagnostic> all(diagnostics.begin(), diagnostics.end());
+    size_t numChunks = (all.size() + ChunkSize - 1) / ChunkSize;
+
+    // Each chunk needs to know which buffer the diagnostic preceding it was in, so
+    // that include stacks get printed at the same places they would be serially.
+    auto renderChunk = [&](size_t index, std::string& result) {
+        size_t start = index * ChunkSize;
+        BufferID lastBuffer;
+        if (start)
+            lastBuffer = sourceManager.getFullyExpandedLoc(all[start - 1].location).buffer();
+
+        size_t count = std::min(ChunkSize, all.size() - start);
+        reportChunk(all.subspan(start, count), lastBuffer, result);
+    };
+
+    numThreads = (uint32_t)std::min(size_t(numThreads), numChunks);
+    if (numThreads <= 1) {
+        for (size_t i = 0; i < numChunks; i++) {
+            std::string text;
+            renderChunk(i, text);
+            sink(std::move(text));
+        }
+        return;
+    }
+
+    // Worker threads pull chunk indices and render them, while this thread hands the
+    // finished chunks to the sink in order. Workers stay at most a fixed window of
+    // chunks ahead of the sink, so memory stays bounded even if the sink is slow.
+    struct Slot {
+        std::string text;
+        std::exception_ptr error;
+        bool ready = false;
+    };
+
+    const size_t Window = size_t(numThreads) * 2;
+    std::vector<Slot> slots(Window);
+    std::mutex mutex;
+    std::condition_variable cv;
+    size_t nextChunk = 0;
+    size_t nextOut = 0;
+    bool cancelled = false;
+
+    auto worker = [&] {
+        while (true) {
+            size_t index;
+            {
+                std::unique_lock lock(mutex);
+                cv.wait(lock, [&] {
+                    return cancelled || nextChunk >= numChunks || nextChunk < nextOut + Window;
+                });
+                if (cancelled || nextChunk >= numChunks)
+                    return;
+                index = nextChunk++;
+            }
 
+            std::string text;
+            std::exception_ptr error;
+            try {
+                renderChunk(index, text);
+            }
+            catch (...) {
+                error = std::current_exception();
+            }
+
+            std::unique_lock lock(mutex);
+            Slot& slot = slots[index % Window];
+            slot.text = std::move(text);
+            slot.error = error;
+            slot.ready = true;
+            cv.notify_all();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < numThreads; i++)
+        threads.emplace_back(worker);
+
+    auto finish = [&] {
+        {
+            std::unique_lock lock(mutex);
+            cancelled = true;
+            cv.notify_all();
+        }
+        for (auto& thread : threads)
+            thread.join();
+    };
+
+    try {
+        for (size_t i = 0; i < numChunks; i++) {
+            std::string text;
+            {
+                std::unique_lock lock(mutex);
+                Slot& slot = slots[i % Window];
+                cv.wait(lock, [&] { return slot.ready; });
+                if (slot.error)
+                    std::rethrow_exception(slot.error);
+
+                text = std::move(slot.text);
+                slot.ready = false;
+                nextOut++;
+                cv.notify_all();
+            }
+            sink(std::move(text));
+        }
+    }
+    catch (...) {
+        finish();
+        throw;
+    }
+    finish();
+}
+
+void DiagnosticWriter::reportChunk(span<const Diagnostic> diagnostics, BufferID lastBuffer,
+                                   std::string& result) {
+    FormatBuffer buffer;
     for (auto& diag : diagnostics) {
         SourceLocation loc = sourceManager.getFullyExpandedLoc(diag.location);
         if (loc.buffer() != lastBuffer) {
             // We're looking at diagnostics from another file now. See if we should print
             // include stack info before we go on with the reports.
             lastBuffer = loc.buffer();
-            getIncludeStack(lastBuffer, includeStack);
-
-            for (auto& includeLoc : includeStack) {
-                buffer.format("in file included from {}:{}:\n",
-                              sourceManager.getFileName(includeLoc),
-                              sourceManager.getLineNumber(includeLoc));
-            }
+            buffer.append(getIncludeStack(lastBuffer));
         }
         buffer.append(report(diag));
     }
-    return buffer.str();
+    result = buffer.str();
 }
 
 string_view DiagnosticWriter::getBufferLine(SourceLocation location, uint32_t col) {
@@ -258,16 +375,30 @@ string_view DiagnosticWriter::getBufferLine(SourceLocation location, uint32_t co
     return string_view(start, (uint32_t)(curr - start));
 }
 
-void DiagnosticWriter::getIncludeStack(BufferID buffer, std::deque<SourceLocation>& stack) {
-    stack.clear();
-    while (buffer) {
-        SourceLocation loc = sourceManager.getIncludedFrom(buffer);
+std::string DiagnosticWriter::getIncludeStack(BufferID buffer) {
+    std::lock_guard<std::mutex> lock(includeStackMutex);
+    auto it = includeStackCache.find(buffer);
+    if (it != includeStackCache.end())
+        return it->second;
+
+    SmallVectorSized<SourceLocation, 8> stack;
+    for (BufferID current = buffer; current;) {
+        SourceLocation loc = sourceManager.getIncludedFrom(current);
         if (!loc.buffer())
             break;
 
-        stack.push_front(loc);
-        buffer = loc.buffer();
+        stack.append(loc);
+        current = loc.buffer();
     }
+
+    FormatBuffer text;
+    for (size_t i = stack.size(); i > 0; i--) {
+        SourceLocation loc = stack[i - 1];
+        text.format("in file included from {}:{}:\n", sourceManager.getFileName(loc),
+                    sourceManager.getLineNumber(loc));
+    }
+
+    return includeStackCache.emplace(buffer, text.str()).first->second;
 }
 
 void DiagnosticWriter::highlightRange(SourceRange range, SourceLocation caretLoc, uint32_t col,
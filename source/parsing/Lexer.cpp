@@ -9,6 +9,7 @@
 #include "../text/CharInfo.h"
 #include <algorithm>
 #include <cmath>
+#include <cstring>
 
 #include "slang/syntax/SyntaxNode.h"
 #include "slang/text/SourceManager.h"
@@ -69,6 +70,14 @@ Lexer::Lexer(SourceBuffer buffer, BumpAllocator& alloc, Diagnostics& diagnostics
     Lexer(buffer.id, buffer.data, buffer.data.data(), alloc, diagnostics, options) {
 }
 
+Lexer::Lexer(SourceBuffer buffer, size_t startOffset, size_t endOffset, BumpAllocator& alloc,
+             Diagnostics& diagnostics, LexerOptions options) :
+    Lexer(buffer.id, buffer.data, buffer.data.data() + startOffset, alloc, diagnostics,
+          options) {
+    ASSERT(startOffset <= endOffset && endOffset < buffer.data.length());
+    rangeEnd = buffer.data.data() + endOffset;
+}
+
 Lexer::Lexer(BufferID bufferId, string_view source, const char* startPtr, BumpAllocator& alloc,
              Diagnostics& diagnostics, LexerOptions options) :
     alloc(alloc),
@@ -79,7 +88,7 @@ Lexer::Lexer(BufferID bufferId, string_view source, const char* startPtr, BumpAl
     ASSERT(sourceEnd[-1] == '\0');
 
     // detect BOMs so we can give nice errors for invaild encoding
-    if (count >= 2) {
+    if (count >= 2 && sourceBuffer == originalBegin) {
         const unsigned char* ubuf = reinterpret_cast<const unsigned char*>(sourceBuffer);
         if ((ubuf[0] == 0xFF && ubuf[1] == 0xFE) || (ubuf[0] == 0xFE && ubuf[1] == 0xFF)) {
             addDiag(DiagCode::UnicodeBOM, 0);
@@ -198,7 +207,17 @@ void Lexer::splitTokens(BumpAllocator& alloc, Diagnostics& diagnostics,
 
 Token Lexer::lex(KeywordVersion keywordVersion) {
     auto info = alloc.emplace<Token::Info>();
+    if (sourceBuffer == rangeEnd) {
+        mark();
+        info->location = SourceLocation(getBufferID(), currentOffset());
+        return Token(TokenKind::EndOfFile, info);
+    }
+
     SmallVectorSized<Trivia, 32> triviaBuffer;
+    if (!disabledText.empty()) {
+        triviaBuffer.append(Trivia(TriviaKind::DisabledText, disabledText));
+        disabledText = string_view();
+    }
     lexTrivia(triviaBuffer);
 
     // lex the next token
@@ -207,6 +226,27 @@ Token Lexer::lex(KeywordVersion keywordVersion) {
     onNewLine = false;
     info->rawText = lexeme();
 
+    if (options.discardTrivia) {
+        switch (kind) {
+            case TokenKind::Directive:
+                if (!inDirectiveLine) {
+                    inDirectiveLine = true;
+                    directiveParenDepth = 0;
+                }
+                break;
+            case TokenKind::OpenParenthesis:
+                if (inDirectiveLine)
+                    directiveParenDepth++;
+                break;
+            case TokenKind::CloseParenthesis:
+                if (directiveParenDepth)
+                    directiveParenDepth--;
+                break;
+            default:
+                break;
+        }
+    }
+
     if (kind != TokenKind::EndOfFile && diagnostics.size() > options.maxErrors) {
         // Stop any further lexing by claiming to be at the end of the buffer.
         // TODO: this check needs work
@@ -219,6 +259,104 @@ Token Lexer::lex(KeywordVersion keywordVersion) {
     return Token(kind, info);
 }
 
+static bool isConditionalDirective(string_view name) {
+    return name == "ifdef" || name == "ifndef" || name == "elsif" || name == "else" ||
+           name == "endif";
+}
+
+void Lexer::skipDisabledText() {
+    mark();
+    const char* directiveStart = nullptr;
+    while (!directiveStart) {
+        // Jump straight to the next character that could start a directive, comment,
+        // string literal, or escaped identifier.
+        sourceBuffer += strcspn(sourceBuffer, "`\"/\\");
+
+        switch (peek()) {
+            case '\0':
+                if (reallyAtEnd()) {
+                    directiveStart = sourceBuffer;
+                    break;
+                }
+                advance();
+                break;
+            case '`': {
+                const char* start = sourceBuffer;
+                advance();
+                if (peek() == '"' || peek() == '`') {
+                    advance();
+                }
+                else if (peek() == '\\' && peek(1) == '`' && peek(2) == '"') {
+                    advance(3);
+                }
+                else {
+                    const char* nameStart = sourceBuffer;
+                    scanIdentifier();
+                    string_view name(nameStart, size_t(sourceBuffer - nameStart));
+                    if (isConditionalDirective(name))
+                        directiveStart = start;
+                }
+                break;
+            }
+            case '"':
+                advance();
+                while (true) {
+                    char c = peek();
+                    if (c == '\\') {
+                        advance();
+                        if (peek() != '\0')
+                            advance();
+                    }
+                    else if (c == '"') {
+                        advance();
+                        break;
+                    }
+                    else if (isNewline(c) || (c == '\0' && reallyAtEnd())) {
+                        break;
+                    }
+                    else {
+                        advance();
+                    }
+                }
+                break;
+            case '/':
+                advance();
+                if (peek() == '/') {
+                    while (!isNewline(peek()) && !(peek() == '\0' && reallyAtEnd()))
+                        advance();
+                }
+                else if (peek() == '*') {
+                    advance();
+                    while (!(peek() == '*' && peek(1) == '/')) {
+                        if (peek() == '\0' && reallyAtEnd())
+                            break;
+                        advance();
+                    }
+                    if (peek() == '*')
+                        advance(2);
+                }
+                break;
+            case '\\':
+                advance();
+                while (!isWhitespace(peek()) && !(peek() == '\0' && reallyAtEnd()))
+                    advance();
+                break;
+            default:
+                THROW_UNREACHABLE;
+        }
+    }
+
+    sourceBuffer = directiveStart;
+    disabledText = lexeme();
+
+    // Keep track of whether the directive we stopped at begins its own line.
+    const char* ptr = sourceBuffer;
+    while (ptr != marker && isHorizontalWhitespace(ptr[-1]))
+        ptr--;
+    if (ptr != marker)
+        onNewLine = isNewline(ptr[-1]);
+}
+
 TokenKind Lexer::lexToken(Token::Info* info, KeywordVersion keywordVersion) {
     uint32_t offset = currentOffset();
     info->location = SourceLocation(getBufferID(), offset);
@@ -968,13 +1106,11 @@ void Lexer::lexTrivia(SmallVector<Trivia>& triviaBuffer) {
             case '\r':
                 advance();
                 consume('\n');
-                onNewLine = true;
-                addTrivia(TriviaKind::EndOfLine, triviaBuffer);
+                addEndOfLine(triviaBuffer);
                 break;
             case '\n':
                 advance();
-                onNewLine = true;
-                addTrivia(TriviaKind::EndOfLine, triviaBuffer);
+                addEndOfLine(triviaBuffer);
                 break;
             default:
                 return;
@@ -1077,9 +1213,25 @@ void Lexer::scanBlockComment(SmallVector<Trivia>& triviaBuffer) {
 }
 
 void Lexer::addTrivia(TriviaKind kind, SmallVector<Trivia>& triviaBuffer) {
+    if (options.discardTrivia && !inDirectiveLine)
+        return;
+
     triviaBuffer.emplace(kind, lexeme());
 }
 
+void Lexer::addEndOfLine(SmallVector<Trivia>& triviaBuffer) {
+    // A directive line keeps going if a line comment ends with a continuation
+    // or if we're still in the middle of a macro's argument list.
+    if (inDirectiveLine && !directiveParenDepth &&
+        (triviaBuffer.empty() || triviaBuffer.back().kind != TriviaKind::LineComment ||
+         triviaBuffer.back().getRawText().back() != '\\')) {
+        inDirectiveLine = false;
+    }
+
+    onNewLine = true;
+    triviaBuffer.emplace(TriviaKind::EndOfLine, lexeme());
+}
+
 void Lexer::addDiag(DiagCode code, uint32_t offset) {
     diagnostics.emplace(code, SourceLocation(getBufferID(), offset));
     errorCount++;
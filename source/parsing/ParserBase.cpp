@@ -33,16 +33,16 @@ Diagnostic& ParserBase::addDiag(DiagCode code, SourceLocation location) {
 }
 
 Token ParserBase::peek(uint32_t offset) {
-    while (window.currentOffset + offset >= window.count)
+    while (offset >= window.count)
         window.addNew();
-    return window.buffer[window.currentOffset + offset];
+    return window.at(offset);
 }
 
 Token ParserBase::peek() {
     if (!window.currentToken) {
-        if (window.currentOffset >= window.count)
+        if (!window.count)
             window.addNew();
-        window.currentToken = window.buffer[window.currentOffset];
+        window.currentToken = window.at(0);
     }
     ASSERT(window.currentToken);
     return window.currentToken;
@@ -98,33 +98,31 @@ Token ParserBase::getLastConsumed() const {
 }
 
 void ParserBase::Window::addNew() {
-    if (count >= capacity) {
-        // shift tokens to the left if we are too far to the right
-        if (currentOffset > (capacity >> 1)) {
-            uint32_t shift = count - currentOffset;
-            if (shift > 0)
-                memmove(buffer, buffer + currentOffset, shift * sizeof(Token));
-
-            count -= currentOffset;
-            currentOffset = 0;
-        }
-        else {
-            capacity *= 2;
-            Token* newBuffer = new Token[capacity];
-            memcpy(newBuffer, buffer, count * sizeof(Token));
-
+    if (count == capacity) {
+        // The ring is full; unwrap it into a larger buffer. This only happens
+        // for unusually deep lookahead, so the common case never allocates.
+        uint32_t newCapacity = capacity * 2;
+        Token* newBuffer = new Token[newCapacity];
+        for (uint32_t i = 0; i < count; i++)
+            newBuffer[i] = at(i);
+
+        if (buffer != inlineBuffer)
             delete[] buffer;
-            buffer = newBuffer;
-        }
+
+        buffer = newBuffer;
+        capacity = newCapacity;
+        head = 0;
     }
-    buffer[count] = tokenSource.next();
+    at(count) = tokenSource.next();
     count++;
 }
 
 void ParserBase::Window::moveToNext() {
+    ASSERT(count > 0);
     lastConsumed = currentToken;
     currentToken = Token();
-    currentOffset++;
+    head = (head + 1) & (capacity - 1);
+    count--;
 }
 
 } // namespace slang
\ No newline at end of file
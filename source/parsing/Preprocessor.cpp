@@ -102,6 +102,15 @@ void Preprocessor::pushSource(SourceBuffer buffer) {
     lexerStack.push_back(lexer);
 }
 
+void Preprocessor::pushSource(SourceBuffer buffer, size_t startOffset, size_t endOffset) {
+    ASSERT(lexerStack.size() < options.maxIncludeDepth);
+    ASSERT(buffer.id);
+
+    auto lexer = alloc.emplace<Lexer>(buffer, startOffset, endOffset, alloc, diagnostics,
+                                      lexerOptions);
+    lexerStack.push_back(lexer);
+}
+
 void Preprocessor::predefine(string_view definition, string_view fileName) {
     std::string text = "`define " + std::string(definition) + "\n";
 
@@ -118,28 +127,92 @@ void Preprocessor::predefine(string_view definition, string_view fileName) {
     // Any macros found that are not the built-in intrinsic macros should
     // be copied over to our own map.
     for (const auto& pair : pp.macros) {
-        if (!pair.second.isIntrinsic())
-            macros.insert(pair);
+        if (pair.second.valid() && !pair.second.isIntrinsic())
+            macros[pair.first] = pair.second;
     }
 }
 
 bool Preprocessor::undefine(string_view name) {
     auto it = macros.find(name);
-    if (it != macros.end() && !it->second.isIntrinsic()) {
-        macros.erase(it);
+    if (it != macros.end()) {
+        if (!it->second.valid() || it->second.isIntrinsic())
+            return false;
+
+        // If an older layer might have the macro we need to leave a marker to hide it.
+        if (macroBase)
+            it->second = MacroDef();
+        else
+            macros.erase(it);
         return true;
     }
+
+    for (auto layer = macroBase.get(); layer; layer = layer->parent.get()) {
+        auto layerIt = layer->macros.find(name);
+        if (layerIt != layer->macros.end()) {
+            if (!layerIt->second.valid() || layerIt->second.isIntrinsic())
+                return false;
+
+            // Use the layer's key, since the caller's name may not outlive us.
+            macros.emplace(layerIt->first, MacroDef());
+            return true;
+        }
+    }
     return false;
 }
 
 void Preprocessor::undefineAll() {
     macros.clear();
+    macroBase.reset();
     macros["__FILE__"] = MacroIntrinsic::File;
     macros["__LINE__"] = MacroIntrinsic::Line;
 }
 
 bool Preprocessor::isDefined(string_view name) {
-    return !name.empty() && macros.find(name) != macros.end();
+    return !name.empty() && findMacro(name).valid();
+}
+
+Preprocessor::MacroSnapshot Preprocessor::getMacroSnapshot() {
+    if (!macros.empty() || !macroBase) {
+        auto layer = std::make_shared<MacroLayer>();
+        layer->macros = std::move(macros);
+        macros.clear();
+
+        if (macroBase && macroBase->depth >= MaxMacroLayers) {
+            // Too many layers make lookups slow, so flatten them all into this one.
+            // Older layers are visited last and so lose to newer definitions.
+            MacroMap merged = std::move(layer->macros);
+            for (auto base = macroBase.get(); base; base = base->parent.get()) {
+                for (auto& pair : base->macros) {
+                    if (merged.find(pair.first) == merged.end())
+                        merged.emplace(pair);
+                }
+            }
+
+            // Now that nothing is hidden, undefined markers can go.
+            layer->macros.clear();
+            for (auto& pair : merged) {
+                if (pair.second.valid())
+                    layer->macros.emplace(pair);
+            }
+        }
+        else if (macroBase) {
+            layer->parent = macroBase;
+            layer->depth = macroBase->depth + 1;
+        }
+
+        macroBase = std::move(layer);
+    }
+
+    return MacroSnapshot(macroBase);
+}
+
+void Preprocessor::setMacros(const MacroSnapshot& snapshot) {
+    macros.clear();
+    macroBase = snapshot.layer;
+    if (!macroBase) {
+        macros["__FILE__"] = MacroIntrinsic::File;
+        macros["__LINE__"] = MacroIntrinsic::Line;
+    }
 }
 
 void Preprocessor::setKeywordVersion(KeywordVersion version) {
@@ -516,7 +589,7 @@ Trivia Preprocessor::handleIfDefDirective(Token directive, bool inverted) {
     bool take = false;
     if (branchStack.empty() || branchStack.back().currentActive) {
         // decide whether the branch is taken or skipped
-        take = macros.find(name.valueText()) != macros.end();
+        take = findMacro(name.valueText()).valid();
         if (inverted)
             take = !take;
     }
@@ -559,7 +632,7 @@ bool Preprocessor::shouldTakeElseBranch(SourceLocation location, bool isElseIf,
         // only take this branch if we're the only one in the stack, or our parent is active
         if (branchStack.size() == 1 || branchStack[branchStack.size() - 2].currentActive) {
             // if this is an elseif, the macro name needs to be defined
-            taken = !isElseIf || macros.find(macroName) != macros.end();
+            taken = !isElseIf || findMacro(macroName).valid();
         }
     }
 
@@ -571,6 +644,15 @@ bool Preprocessor::shouldTakeElseBranch(SourceLocation location, bool isElseIf,
 Trivia Preprocessor::parseBranchDirective(Token directive, Token condition, bool taken) {
     scratchTokenBuffer.clear();
     if (!taken) {
+        // If we're reading straight from a source file, let the lexer jump over the
+        // disabled text without tokenizing it; it will end up as trivia on the next
+        // directive, so the loop below will only need to look at one token.
+        bool skipped = false;
+        if (!currentToken && !currentMacroToken && !lexerStack.empty()) {
+            lexerStack.back()->skipDisabledText();
+            skipped = true;
+        }
+
         // skip over everything until we find another conditional compilation directive
         while (true) {
             auto token = nextRaw();
@@ -594,6 +676,15 @@ Trivia Preprocessor::parseBranchDirective(Token directive, Token condition, bool
             }
 
             if (done) {
+                // Skipped text is attached to the token that ended it; move it into this
+                // directive instead, as an empty token that carries just that trivia.
+                auto trivia = token.trivia();
+                if (skipped && !trivia.empty() && trivia[0].kind == TriviaKind::DisabledText) {
+                    auto info = alloc.emplace<Token::Info>(trivia.first(1), "", token.location());
+                    scratchTokenBuffer.append(Token(TokenKind::Unknown, info));
+                    token = token.withTrivia(alloc, trivia.subspan(1));
+                }
+
                 // put the token back so that we'll look at it next
                 currentToken = token;
                 break;
@@ -771,12 +862,12 @@ Trivia Preprocessor::handleUndefDirective(Token directive) {
     // TODO: additional checks for undefining other builtin directives
     if (!nameToken.isMissing()) {
         string_view name = nameToken.valueText();
-        auto it = macros.find(name);
-        if (it != macros.end()) {
-            if (name != "__LINE__" && name != "__FILE__")
-                macros.erase(it);
-            else
+        auto macro = findMacro(name);
+        if (macro.valid()) {
+            if (macro.isIntrinsic())
                 addDiag(DiagCode::UndefineBuiltinDirective, nameToken.location());
+            else
+                undefine(name);
         }
     }
 
@@ -822,10 +913,20 @@ Preprocessor::MacroDef Preprocessor::findMacro(Token directive) {
     if (!name.empty() && name[0] == '\\')
         name = name.substr(1);
 
+    return findMacro(name);
+}
+
+Preprocessor::MacroDef Preprocessor::findMacro(string_view name) const {
     auto it = macros.find(name);
-    if (it == macros.end())
-        return nullptr;
-    return it->second;
+    if (it != macros.end())
+        return it->second;
+
+    for (auto layer = macroBase.get(); layer; layer = layer->parent.get()) {
+        it = layer->macros.find(name);
+        if (it != layer->macros.end())
+            return it->second;
+    }
+    return nullptr;
 }
 
 MacroActualArgumentListSyntax* Preprocessor::handleTopLevelMacro(Token directive) {
@@ -851,11 +952,21 @@ MacroActualArgumentListSyntax* Preprocessor::handleTopLevelMacro(Token directive
             return nullptr;
     }
 
-    // Expand out the macro
-    SmallVectorSized<Token, 32> buffer;
-    MacroExpansion expansion{ alloc, buffer, directive, true };
-    if (!expandMacro(macro, expansion, actualArgs))
+    // Expand out the macro. The tokens go straight into the output buffer; in the
+    // common case where they contain no nested macros or macro operators that's
+    // all we need to do.
+    expandedTokens.clear();
+    MacroExpansion expansion{ alloc, expandedTokens, directive, true };
+    if (!expandMacro(macro, expansion, actualArgs)) {
+        expandedTokens.clear();
+        return actualArgs;
+    }
+
+    if (!expansion.needsRescan()) {
+        if (!expandedTokens.empty())
+            currentMacroToken = expandedTokens.begin();
         return actualArgs;
+    }
 
     // The macro is now expanded out into tokens, but some of those tokens might
     // be more macros that need to be expanded, or special characters that
@@ -866,11 +977,13 @@ MacroActualArgumentListSyntax* Preprocessor::handleTopLevelMacro(Token directive
     if (!macro.isIntrinsic())
         alreadyExpanded.insert(macro.syntax);
 
-    span<Token const> tokens = buffer.copy(alloc);
+    span<Token const> tokens = expandedTokens.copy(alloc);
     while (true) {
         // Start by recursively expanding out all valid macro usages.
-        if (!expandReplacementList(tokens, alreadyExpanded))
+        if (!expandReplacementList(tokens, alreadyExpanded)) {
+            expandedTokens.clear();
             return actualArgs;
+        }
 
         // Now that all macros have been expanded, handle token concatenation and stringification.
         expandedTokens.clear();
@@ -1055,12 +1168,12 @@ bool Preprocessor::expandMacro(MacroDef macro, MacroExpansion& expansion,
         using span<const Token>::operator=;
         bool isExpanded = false;
     };
-    SmallMap<string_view, ArgTokens, 8> argumentMap;
+    SmallVectorSized<ArgTokens, 8> arguments;
 
     for (uint32_t i = 0; i < formalList.size(); i++) {
         auto formal = formalList[i];
-        auto name = formal->name.valueText();
-        if (name.empty())
+        arguments.emplace();
+        if (formal->name.valueText().empty())
             continue;
 
         const TokenList* tokenList = nullptr;
@@ -1080,7 +1193,7 @@ bool Preprocessor::expandMacro(MacroDef macro, MacroExpansion& expansion,
             }
         }
 
-        argumentMap.emplace(name, ArgTokens(*tokenList));
+        arguments.back() = ArgTokens(*tokenList);
     }
 
     Token endOfArgs = actualArgs->getLastToken();
@@ -1090,46 +1203,32 @@ bool Preprocessor::expandMacro(MacroDef macro, MacroExpansion& expansion,
         macroName);
 
     // now add each body token, substituting arguments as necessary
-    for (auto& token : body) {
+    auto& argSlots = getMacroTemplate(*directive).argSlots;
+    for (ptrdiff_t i = 0; i < body.size(); i++) {
+        const Token& token = body[i];
         SourceLocation location = expansionLoc + (token.location() - start);
 
-        if (token.kind != TokenKind::Identifier && !isKeyword(token.kind) &&
-            (token.kind != TokenKind::Directive ||
-             token.directiveKind() != SyntaxKind::MacroUsage)) {
-
-            expansion.append(token, location);
-            continue;
-        }
-
-        // Other tools allow arguments to replace matching directive names, e.g.:
-        // `define FOO(bar) `bar
-        // `define ONE 1
-        // `FOO(ONE)   // expands to 1
-        string_view text = token.valueText();
-        if (token.kind == TokenKind::Directive && text.length() >= 1)
-            text = text.substr(1);
-
-        // check for formal param
-        auto it = argumentMap.find(text);
-        if (it == argumentMap.end()) {
+        int32_t slot = argSlots[i];
+        if (slot < 0) {
             expansion.append(token, location);
             continue;
         }
 
         // Fully expand out arguments before substitution to make sure we can detect whether
         // a usage of a macro in a replacement list is valid or an illegal recursion.
-        if (!it->second.isExpanded) {
-            span<const Token> argTokens = it->second;
+        ArgTokens& arg = arguments[size_t(slot)];
+        if (!arg.isExpanded) {
+            span<const Token> argTokens = arg;
             SmallSet<DefineDirectiveSyntax*, 8> alreadyExpanded;
             if (!expandReplacementList(argTokens, alreadyExpanded))
                 return false;
 
-            it->second = argTokens;
-            it->second.isExpanded = true;
+            arg = argTokens;
+            arg.isExpanded = true;
         }
 
-        auto begin = it->second.begin();
-        auto end = it->second.end();
+        auto begin = arg.begin();
+        auto end = arg.end();
         if (begin == end) {
             // The macro argument contained no tokens. We still need to supply an empty token
             // here to ensure that the trivia of the formal parameter is passed on.
@@ -1177,6 +1276,46 @@ bool Preprocessor::expandMacro(MacroDef macro, MacroExpansion& expansion,
     return true;
 }
 
+const Preprocessor::MacroTemplate& Preprocessor::getMacroTemplate(
+    const DefineDirectiveSyntax& directive) {
+    auto it = macroTemplates.find(&directive);
+    if (it != macroTemplates.end())
+        return *it->second;
+
+    auto& formalList = directive.formalArguments->args;
+    SmallVectorSized<int32_t, 32> slots;
+    for (auto& token : directive.body) {
+        int32_t slot = -1;
+        if (token.kind == TokenKind::Identifier || isKeyword(token.kind) ||
+            (token.kind == TokenKind::Directive &&
+             token.directiveKind() == SyntaxKind::MacroUsage)) {
+
+            // Other tools allow arguments to replace matching directive names, e.g.:
+            // `define FOO(bar) `bar
+            // `define ONE 1
+            // `FOO(ONE)   // expands to 1
+            string_view text = token.valueText();
+            if (token.kind == TokenKind::Directive && text.length() >= 1)
+                text = text.substr(1);
+
+            // If more than one formal has the same name, the first one wins.
+            for (uint32_t i = 0; i < formalList.size(); i++) {
+                string_view name = formalList[i]->name.valueText();
+                if (!name.empty() && name == text) {
+                    slot = int32_t(i);
+                    break;
+                }
+            }
+        }
+        slots.append(slot);
+    }
+
+    auto result = alloc.emplace<MacroTemplate>();
+    result->argSlots = slots.copy(alloc);
+    macroTemplates.emplace(&directive, result);
+    return *result;
+}
+
 SourceRange Preprocessor::MacroExpansion::getRange() const {
     return { usageSite.location(), usageSite.location() + usageSite.rawText().length() };
 }
@@ -1190,6 +1329,20 @@ void Preprocessor::MacroExpansion::append(Token token, SourceLocation location)
         any = true;
     }
 
+    switch (token.kind) {
+        case TokenKind::MacroQuote:
+        case TokenKind::MacroPaste:
+        case TokenKind::LineContinuation:
+        case TokenKind::EmptyMacroArgument:
+            rescan = true;
+            break;
+        case TokenKind::Directive:
+            rescan |= token.directiveKind() == SyntaxKind::MacroUsage;
+            break;
+        default:
+            break;
+    }
+
     // Line continuations gets stripped out when we expand macros and become newline trivia instead.
     if (token.kind == TokenKind::LineContinuation) {
         SmallVectorSized<Trivia, 8> newTrivia;
@@ -1206,6 +1359,19 @@ void Preprocessor::MacroExpansion::append(Token token, SourceLocation location)
 
 bool Preprocessor::expandReplacementList(span<Token const>& tokens,
                                          SmallSet<DefineDirectiveSyntax*, 8>& alreadyExpanded) {
+    // If there are no macro usages at all there's nothing to do.
+    bool anyMacros = false;
+    for (auto& token : tokens) {
+        if (token.kind == TokenKind::Directive &&
+            token.directiveKind() == SyntaxKind::MacroUsage) {
+            anyMacros = true;
+            break;
+        }
+    }
+
+    if (!anyMacros)
+        return true;
+
     // keep expanding macros in the replacement list until we've got them all
     // use two alternating buffers to hold the tokens
     SmallVectorSized<Token, 64> buffer1;
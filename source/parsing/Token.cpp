@@ -103,25 +103,11 @@ Token::Info::Info(span<Trivia const> trivia, string_view rawText, SourceLocation
 }
 
 void Token::Info::setBit(logic_t value) {
-    NumericLiteralInfo* target = std::get_if<NumericLiteralInfo>(&extra);
-    if (target)
-        target->value = value;
-    else {
-        NumericLiteralInfo numInfo;
-        numInfo.value = value;
-        extra = numInfo;
-    }
+    extra = value;
 }
 
 void Token::Info::setReal(double value) {
-    NumericLiteralInfo* target = std::get_if<NumericLiteralInfo>(&extra);
-    if (target)
-        target->value = value;
-    else {
-        NumericLiteralInfo numInfo;
-        numInfo.value = value;
-        extra = numInfo;
-    }
+    extra = value;
 }
 
 void Token::Info::setInt(BumpAllocator& alloc, const SVInt& value) {
@@ -133,37 +119,15 @@ void Token::Info::setInt(BumpAllocator& alloc, const SVInt& value) {
             (uint64_t*)alloc.allocate(sizeof(uint64_t) * value.getNumWords(), alignof(uint64_t));
         memcpy(storage.pVal, value.getRawData(), sizeof(uint64_t) * value.getNumWords());
     }
-
-    NumericLiteralInfo* target = std::get_if<NumericLiteralInfo>(&extra);
-    if (target)
-        target->value = storage;
-    else {
-        NumericLiteralInfo numInfo;
-        numInfo.value = storage;
-        extra = numInfo;
-    }
+    extra = storage;
 }
 
 void Token::Info::setNumFlags(LiteralBase base, bool isSigned) {
-    NumericLiteralInfo* target = std::get_if<NumericLiteralInfo>(&extra);
-    if (target)
-        target->numericFlags.set(base, isSigned);
-    else {
-        NumericLiteralInfo numInfo;
-        numInfo.numericFlags.set(base, isSigned);
-        extra = numInfo;
-    }
+    numFlags.set(base, isSigned);
 }
 
 void Token::Info::setTimeUnit(TimeUnit unit) {
-    NumericLiteralInfo* target = std::get_if<NumericLiteralInfo>(&extra);
-    if (target)
-        target->numericFlags.set(unit);
-    else {
-        NumericLiteralInfo numInfo;
-        numInfo.numericFlags.set(unit);
-        extra = numInfo;
-    }
+    numFlags.set(unit);
 }
 
 Token::Token() : kind(TokenKind::Unknown), info(nullptr) {
@@ -239,22 +203,22 @@ std::string Token::toString() const {
 
 SVInt Token::intValue() const {
     ASSERT(kind == TokenKind::IntegerLiteral);
-    return std::get<SVIntStorage>(info->numInfo().value);
+    return std::get<SVIntStorage>(info->extra);
 }
 
 double Token::realValue() const {
     ASSERT(kind == TokenKind::RealLiteral || kind == TokenKind::TimeLiteral);
-    return std::get<double>(info->numInfo().value);
+    return std::get<double>(info->extra);
 }
 
 logic_t Token::bitValue() const {
     ASSERT(kind == TokenKind::UnbasedUnsizedLiteral);
-    return std::get<logic_t>(info->numInfo().value);
+    return std::get<logic_t>(info->extra);
 }
 
 NumericTokenFlags Token::numericFlags() const {
     ASSERT(kind == TokenKind::IntegerBase || kind == TokenKind::TimeLiteral);
-    return info->numInfo().numericFlags;
+    return info->numFlags;
 }
 
 IdentifierType Token::identifierType() const {
@@ -0,0 +1,245 @@
+//------------------------------------------------------------------------------
+// ASTSerializer.cpp
+// Streaming serialization of the AST.
+//
+// File is under the MIT license; see LICENSE for details.
+//------------------------------------------------------------------------------
+#include "slang/symbols/ASTSerializer.h"
+
+#include <istream>
+#include <nlohmann/json.hpp>
+#include <ostream>
+
+#include "slang/util/BinaryFormat.h"
+
+namespace {
+
+// The binary format is a fixed header followed by a sequence of records.
+// Each record is a one byte tag, a variable length payload size, and then the
+// payload itself. Strings are written once, as they're first needed, and
+// referred to by index thereafter.
+const slang::BinaryFormat BinaryAST{ "SLANGAST", 1, "binary AST" };
+
+enum RecordTag : uint8_t {
+    // payload: the raw string data; assigned the next string index
+    StringTag = 1,
+
+    // payload: varint name index, varint kind index, varint address,
+    // then any remaining properties encoded as CBOR
+    BeginSymbolTag = 2,
+
+    // payload: empty
+    EndSymbolTag = 3,
+
+    // payload: varint index of the type's text
+    TypeTag = 4
+};
+
+} // namespace
+
+namespace slang {
+
+ASTSerializer::ASTSerializer(std::ostream& stream, Format format) :
+    stream(stream), format(format) {
+
+    if (format == Format::Binary)
+        BinaryAST.writeHeader(stream);
+}
+
+void ASTSerializer::serialize(const Symbol& symbol) {
+    symbol.visit(*this);
+    if (format == Format::Json)
+        stream << '\n';
+}
+
+void ASTSerializer::startSymbol(const Symbol& symbol) {
+    startMember();
+
+    json j;
+    propertiesToJson(j, symbol);
+
+    if (format == Format::Json) {
+        // Leave the object open so that members can be appended.
+        std::string text = j.dump();
+        text.pop_back();
+        stream << text;
+        membersOpen.append(false);
+        return;
+    }
+
+    std::string payload;
+    BinaryFormat::appendVarInt(payload, getStringId(symbol.name));
+    BinaryFormat::appendVarInt(payload, getStringId(toString(symbol.kind)));
+    BinaryFormat::appendVarInt(payload, uintptr_t(&symbol));
+
+    j.erase("name");
+    j.erase("kind");
+    j.erase("addr");
+    if (!j.empty()) {
+        auto cbor = json::to_cbor(j);
+        payload.append(reinterpret_cast<const char*>(cbor.data()), cbor.size());
+    }
+    writeRecord(BeginSymbolTag, payload);
+}
+
+void ASTSerializer::endSymbol() {
+    if (format == Format::Json) {
+        if (membersOpen.back())
+            stream << "\n" << std::string(membersOpen.size() * 2 - 2, ' ') << ']';
+        stream << '}';
+        membersOpen.pop();
+        return;
+    }
+
+    writeRecord(EndSymbolTag, {});
+}
+
+void ASTSerializer::writeType(const Type& type) {
+    startMember();
+
+    std::string text = type.toString();
+    if (format == Format::Json) {
+        stream << json(text).dump();
+        return;
+    }
+
+    std::string payload;
+    BinaryFormat::appendVarInt(payload, getStringId(text));
+    writeRecord(TypeTag, payload);
+}
+
+void ASTSerializer::startMember() {
+    if (format != Format::Json || membersOpen.empty())
+        return;
+
+    if (!membersOpen.back()) {
+        stream << ",\"members\":[";
+        membersOpen.back() = true;
+    }
+    else {
+        stream << ',';
+    }
+    stream << "\n" << std::string(membersOpen.size() * 2, ' ');
+}
+
+uint32_t ASTSerializer::getStringId(string_view str) {
+    std::string key(str);
+    auto it = stringTable.find(key);
+    if (it != stringTable.end())
+        return it->second;
+
+    uint32_t id = uint32_t(stringTable.size());
+    stringTable.emplace(key, id);
+    writeRecord(StringTag, key);
+    return id;
+}
+
+void ASTSerializer::writeRecord(uint8_t tag, const std::string& payload) {
+    std::string header;
+    header.push_back(char(tag));
+    BinaryFormat::appendVarInt(header, payload.size());
+    stream.write(header.data(), std::streamsize(header.size()));
+    stream.write(payload.data(), std::streamsize(payload.size()));
+}
+
+json BinaryASTReader::Record::getProperties() const {
+    if (propertyData.empty())
+        return json::object();
+    return json::from_cbor(propertyData);
+}
+
+BinaryASTReader::BinaryASTReader(std::istream& stream) : stream(stream) {
+    BinaryAST.readHeader(stream);
+}
+
+bool BinaryASTReader::next(Record& record) {
+    while (true) {
+        int tag = stream.get();
+        if (tag == std::char_traits<char>::eof())
+            return false;
+
+        std::string payload(BinaryAST.readVarInt(stream), '\0');
+        if (!stream.read(payload.data(), std::streamsize(payload.size())))
+            BinaryAST.malformed();
+
+        auto getString = [&](size_t& offset) {
+            uint64_t index = BinaryAST.readVarInt(payload, offset);
+            if (index >= strings.size())
+                BinaryAST.malformed();
+            return string_view(strings[index]);
+        };
+
+        size_t offset = 0;
+        switch (tag) {
+            case StringTag:
+                strings.emplace_back(std::move(payload));
+                continue;
+            case BeginSymbolTag:
+                record.kind = RecordKind::BeginSymbol;
+                record.name = getString(offset);
+                record.symbolKind = getString(offset);
+                record.address = BinaryAST.readVarInt(payload, offset);
+                record.propertyData = payload.substr(offset);
+                return true;
+            case EndSymbolTag:
+                record.kind = RecordKind::EndSymbol;
+                record.name = {};
+                record.symbolKind = {};
+                record.address = 0;
+                record.propertyData.clear();
+                return true;
+            case TypeTag:
+                record.kind = RecordKind::Type;
+                record.name = getString(offset);
+                record.symbolKind = {};
+                record.address = 0;
+                record.propertyData.clear();
+                return true;
+            default:
+                BinaryAST.malformed();
+        }
+    }
+}
+
+json BinaryASTReader::readAll() {
+    json result;
+    std::vector<json> stack;
+    auto addMember = [&](json&& value) {
+        if (stack.empty())
+            result = std::move(value);
+        else
+            stack.back()["members"].push_back(std::move(value));
+    };
+
+    Record record;
+    while (next(record)) {
+        switch (record.kind) {
+            case RecordKind::BeginSymbol: {
+                json j = record.getProperties();
+                j["name"] = std::string(record.name);
+                j["kind"] = std::string(record.symbolKind);
+                j["addr"] = record.address;
+                stack.emplace_back(std::move(j));
+                break;
+            }
+            case RecordKind::EndSymbol: {
+                if (stack.empty())
+                    BinaryAST.malformed();
+
+                json j = std::move(stack.back());
+                stack.pop_back();
+                addMember(std::move(j));
+                break;
+            }
+            case RecordKind::Type:
+                addMember(std::string(record.name));
+                break;
+        }
+    }
+
+    if (!stack.empty())
+        BinaryAST.malformed();
+    return result;
+}
+
+} // namespace slang
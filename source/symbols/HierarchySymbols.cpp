@@ -8,6 +8,7 @@
 
 #include <nlohmann/json.hpp>
 
+#include "slang/binding/CompactExpression.h"
 #include "slang/compilation/Compilation.h"
 #include "slang/util/StackContainer.h"
 
@@ -120,6 +121,96 @@ DefinitionSymbol& DefinitionSymbol::fromSyntax(Compilation& compilation,
     return *result;
 }
 
+static bool overridesMatch(const Expression* a, const Expression* b) {
+    if (!a || !b)
+        return a == b;
+
+    return a->type == b->type && exactlyEqual(*a->constant, *b->constant);
+}
+
+bool DefinitionSpecialization::matches(span<const Expression* const> otherOverrides) const {
+    if (overrides.size() != size_t(otherOverrides.size()))
+        return false;
+
+    for (size_t i = 0; i < overrides.size(); i++) {
+        if (!overridesMatch(overrides[i], otherOverrides[ptrdiff_t(i)]))
+            return false;
+    }
+    return true;
+}
+
+static bool mayHaveInterfacePorts(const ModuleDeclarationSyntax& syntax) {
+    // Parameter values in an instance with interface ports can depend on the parameters of
+    // whatever gets connected to those ports, so they can't be shared between instances.
+    // An ANSI port whose header is just a name might be an interface port; we can't know
+    // without doing a lookup, so be conservative. The same goes for any non-ANSI port list,
+    // since its ports are declared down in the body.
+    if (!syntax.header->ports)
+        return false;
+
+    if (syntax.header->ports->kind != SyntaxKind::AnsiPortList)
+        return true;
+
+    for (auto port : syntax.header->ports->as<AnsiPortListSyntax>().ports) {
+        if (port->kind != SyntaxKind::ImplicitAnsiPort)
+            continue;
+
+        auto& header = *port->as<ImplicitAnsiPortSyntax>().header;
+        if (header.kind == SyntaxKind::InterfacePortHeader)
+            return true;
+
+        if (header.kind == SyntaxKind::VariablePortHeader) {
+            auto& varHeader = header.as<VariablePortHeaderSyntax>();
+            if (!varHeader.direction && !varHeader.varKeyword &&
+                varHeader.dataType->kind == SyntaxKind::NamedType) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+DefinitionSpecialization* DefinitionSymbol::getSpecialization(
+    span<const Expression* const> overrides) const {
+
+    Compilation& comp = getCompilation();
+    if (!comp.getOptions().cacheDefinitionSpecializations)
+        return nullptr;
+
+    if (!canSpecialize)
+        canSpecialize = !mayHaveInterfacePorts(getSyntax()->as<ModuleDeclarationSyntax>());
+
+    if (!*canSpecialize)
+        return nullptr;
+
+    size_t hash = 0;
+    for (auto expr : overrides) {
+        if (!expr) {
+            hash_combine(hash, (const Type*)nullptr);
+            continue;
+        }
+
+        if (!expr->constant || expr->constant->bad())
+            return nullptr;
+
+        hash_combine(hash, expr->type);
+        hash = expr->constant->hash(hash);
+    }
+
+    if (!specializations)
+        specializations = comp.allocSpecializationMap();
+
+    auto& bucket = (*specializations)[hash];
+    for (auto& entry : bucket) {
+        if (entry->matches(overrides))
+            return entry.get();
+    }
+
+    auto& entry = bucket.emplace_back(std::make_unique<DefinitionSpecialization>());
+    entry->overrides.assign(overrides.begin(), overrides.end());
+    return entry.get();
+}
+
 void DefinitionSymbol::toJson(json& j) const {
     j["definitionKind"] = toString(definitionKind);
 }
@@ -192,6 +283,11 @@ void InstanceSymbol::fromSyntax(Compilation& compilation,
                                 const HierarchyInstantiationSyntax& syntax, LookupLocation location,
                                 const Scope& scope, SmallVector<const Symbol*>& results) {
 
+    // Once the error limit has been hit and we've been asked to abort,
+    // don't elaborate any more of the hierarchy.
+    if (compilation.isAborting())
+        return;
+
     auto definition = compilation.getDefinition(syntax.type.valueText(), scope);
     if (!definition) {
         scope.addDiag(DiagCode::UnknownModule, syntax.type.range()) << syntax.type.valueText();
@@ -360,11 +456,14 @@ bool InstanceSymbol::isKind(SymbolKind kind) {
 
 void InstanceSymbol::populate(const HierarchicalInstanceSyntax* instanceSyntax,
                               span<const Expression* const> parameterOverides) {
-    // Add all port parameters as members first.
+    // Instances with the same parameter values share their conditional generate selections.
     Compilation& comp = getCompilation();
+    specialization = definition.getSpecialization(parameterOverides);
+
     auto paramIt = definition.parameters.begin();
     auto overrideIt = parameterOverides.begin();
 
+    // Add all port parameters as members first.
     while (paramIt != definition.parameters.end()) {
         auto original = *paramIt;
         if (!original->isPortParam())
@@ -489,17 +588,94 @@ static string_view getGenerateBlockName(const SyntaxNode& node) {
     return "";
 }
 
+// Finds the set of conditional generate selections, if any, that are shared between the
+// given scope and other scopes that are known to elaborate identically to it. If the set
+// belongs to a generate loop, that loop is returned in @a loop; only conditions that don't
+// depend on anything declared within the loop can be shared by its iterations.
+static GenerateSelectionMap* getSharedSelections(const Scope& scope,
+                                                 const GenerateBlockArraySymbol*& loop) {
+    auto& symbol = scope.asSymbol();
+    if (InstanceSymbol::isKind(symbol.kind)) {
+        // Conditions directly within an instance depend only on its parameters.
+        auto specialization = symbol.as<InstanceSymbol>().getSpecialization();
+        return specialization ? &specialization->generateSelections : nullptr;
+    }
+
+    if (symbol.kind == SymbolKind::GenerateBlock) {
+        // Blocks created by conditional generates depend on the same things as their
+        // parent, while loop iterations share selections with each other.
+        auto parent = symbol.getScope();
+        ASSERT(parent);
+        if (parent->asSymbol().kind == SymbolKind::GenerateBlockArray) {
+            loop = &parent->asSymbol().as<GenerateBlockArraySymbol>();
+            return loop->getSharedSelections();
+        }
+        return getSharedSelections(*parent, loop);
+    }
+
+    return nullptr;
+}
+
+// Determines whether the given bound expression refers to anything declared within the
+// given scope, including the implicit genvar parameters of a loop's iterations.
+static bool dependsOnScope(const Expression& expr, const Scope& scope) {
+    auto isWithin = [&](const Symbol& symbol) {
+        for (auto s = symbol.getScope(); s; s = s->asSymbol().getScope()) {
+            if (s == &scope)
+                return true;
+        }
+        return false;
+    };
+
+    CompactExpressionSet set;
+    set.add(expr);
+    for (auto& node : set) {
+        switch (node.kind) {
+            case ExpressionKind::NamedValue:
+                if (isWithin(node.expr->as<NamedValueExpression>().symbol))
+                    return true;
+                break;
+            case ExpressionKind::Call: {
+                auto& call = node.expr->as<CallExpression>();
+                if (!call.isSystemCall() && isWithin(*std::get<0>(call.subroutine)))
+                    return true;
+                break;
+            }
+            case ExpressionKind::DataType:
+                // Types can be built from the genvar without naming any symbol.
+                return true;
+            default:
+                break;
+        }
+    }
+    return false;
+}
+
 void GenerateBlockSymbol::fromSyntax(Compilation& compilation, const IfGenerateSyntax& syntax,
                                      LookupLocation location, const Scope& parent,
                                      uint32_t constructIndex, bool isInstantiated,
                                      SmallVector<GenerateBlockSymbol*>& results) {
+    const GenerateBlockArraySymbol* loop = nullptr;
+    GenerateSelectionMap* sharedSelections = getSharedSelections(parent, loop);
+
     optional<bool> selector;
     if (isInstantiated) {
-        // TODO: better error checking
-        BindContext bindContext(parent, location, BindFlags::Constant);
-        const auto& cond = Expression::bind(*syntax.condition, bindContext);
-        if (cond.constant)
-            selector = (bool)(logic_t)cond.constant->integer();
+        if (sharedSelections) {
+            auto it = sharedSelections->find(&syntax);
+            if (it != sharedSelections->end())
+                selector = it->second;
+        }
+
+        if (!selector) {
+            // TODO: better error checking
+            BindContext bindContext(parent, location, BindFlags::Constant);
+            const auto& cond = Expression::bind(*syntax.condition, bindContext);
+            if (cond.constant) {
+                selector = (bool)(logic_t)cond.constant->integer();
+                if (sharedSelections && (!loop || !dependsOnScope(cond, *loop)))
+                    sharedSelections->emplace(&syntax, *selector);
+            }
+        }
     }
 
     auto createBlock = [&](const SyntaxNode& syntax, bool isInstantiated, auto attributes) {
@@ -557,35 +733,20 @@ GenerateBlockArraySymbol& GenerateBlockArraySymbol::fromSyntax(
         compilation.emplace<GenerateBlockArraySymbol>(compilation, name, loc, constructIndex);
 
     result->setSyntax(syntax);
+    result->sharedSelections = compilation.allocGenerateSelectionMap();
     compilation.addAttributes(*result, syntax.attributes);
 
-    // TODO: verify that localparam type should be int
-
-    auto createBlock = [&](ConstantValue value, bool isInstantiated) {
-        // Spec: each generate block gets their own scope, with an implicit
-        // localparam of the same name as the genvar.
-        // TODO: block name, location?
-        auto block = compilation.emplace<GenerateBlockSymbol>(compilation, "", SourceLocation(),
-                                                              isInstantiated, 1);
-        auto implicitParam = compilation.emplace<ParameterSymbol>(
-            syntax.identifier.valueText(), syntax.identifier.location(), true /* isLocal */,
-            false /* isPort */);
-
-        block->addMember(*implicitParam);
-        block->addMembers(*syntax.block);
-        result->addMember(*block);
+    // Only the genvar value for each iteration is computed here; the blocks themselves
+    // are created the first time anything looks inside the array.
+    result->setGenerateLoop(*result);
 
-        implicitParam->setType(compilation.getIntType());
-        implicitParam->setValue(std::move(value));
-    };
+    // TODO: verify that localparam type should be int
 
     // Initialize the genvar
     BindContext bindContext(parent, location, BindFlags::Constant);
     const auto& initial = Expression::bind(*syntax.initialExpr, bindContext);
-    if (!initial.constant) {
-        createBlock(SVInt(32, 0, true), false);
+    if (!initial.constant)
         return *result;
-    }
 
     // Fabricate a local variable that will serve as the loop iteration variable.
     SequentialBlockSymbol iterScope(compilation, SourceLocation());
@@ -604,17 +765,73 @@ GenerateBlockArraySymbol& GenerateBlockArraySymbol::fromSyntax(
     EvalContext context;
     auto genvar = context.createLocal(&local, *initial.constant);
 
+    SmallVectorSized<const ConstantValue*, 8> values;
+    for (; stopExpr.evalBool(context); iterExpr.eval(context))
+        values.append(compilation.allocConstant(ConstantValue(*genvar)));
+
+    result->genvarValues = values.copy(compilation);
+    return *result;
+}
+
+void GenerateBlockArraySymbol::createBlocks() {
+    auto& compilation = getCompilation();
+    auto& syntax = getSyntax()->as<LoopGenerateSyntax>();
+    string_view genvarName = syntax.identifier.valueText();
+
+    SmallVectorSized<const GenerateBlockSymbol*, 8> blocks;
+    auto createBlock = [&](const ConstantValue& value, bool isInstantiated) {
+        // Spec: each generate block gets their own scope, with an implicit
+        // localparam of the same name as the genvar.
+        // TODO: block name, location?
+        auto block = compilation.emplace<GenerateBlockSymbol>(compilation, "", SourceLocation(),
+                                                              constructIndex, isInstantiated);
+        auto implicitParam = compilation.emplace<ParameterSymbol>(
+            genvarName, syntax.identifier.location(), true /* isLocal */, false /* isPort */);
+
+        if (auto index = value.integer().as<int32_t>())
+            block->arrayIndex = *index;
+
+        block->addMember(*implicitParam);
+        block->addMembers(*syntax.block);
+        addMember(*block);
+
+        implicitParam->setType(compilation.getIntType());
+        implicitParam->setValue(value);
+
+        if (isInstantiated)
+            blocks.append(block);
+    };
+
     // Generate blocks!
-    bool any = false;
-    for (; stopExpr.evalBool(context); iterExpr.eval(context)) {
-        createBlock(*genvar, true);
-        any = true;
-    }
+    for (auto value : genvarValues)
+        createBlock(*value, true);
 
-    if (!any)
+    if (genvarValues.empty())
         createBlock(SVInt(32, 0, true), false);
 
-    return *result;
+    entries = blocks.copy(compilation);
+}
+
+span<const GenerateBlockSymbol* const> GenerateBlockArraySymbol::getEntries() const {
+    ensureElaborated();
+    return entries;
+}
+
+const GenerateBlockSymbol* GenerateBlockArraySymbol::getEntry(int32_t index) const {
+    auto blocks = getEntries();
+    if (blocks.empty())
+        return nullptr;
+
+    // Most loops count up by one, so check the obvious position before searching.
+    int64_t guess = int64_t(index) - blocks[0]->arrayIndex;
+    if (guess >= 0 && guess < blocks.size() && blocks[guess]->arrayIndex == index)
+        return blocks[guess];
+
+    for (auto entry : blocks) {
+        if (entry->arrayIndex == index)
+            return entry;
+    }
+    return nullptr;
 }
 
 void GenerateBlockArraySymbol::toJson(json& j) const {
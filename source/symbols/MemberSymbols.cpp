@@ -174,7 +174,9 @@ const Expression* PortSymbol::getExternalConnection() const {
         if (!externalSyntax)
             externalConn = nullptr;
         else {
-            BindContext context(*getScope(), LookupLocation::before(*this));
+            // The connection is made in the scope containing the instance.
+            auto& instance = getScope()->asSymbol();
+            BindContext context(*instance.getScope(), LookupLocation::before(instance));
             externalConn = &Expression::bind(getType(), *externalSyntax,
                                              externalSyntax->getFirstToken().location(), context);
         }
@@ -188,7 +190,7 @@ void PortSymbol::setExternalConnection(const Expression* expr) {
 }
 
 void PortSymbol::setExternalConnection(const ExpressionSyntax& syntax) {
-    externalConn = nullptr;
+    externalConn.reset();
     externalSyntax = &syntax;
 }
 
@@ -461,6 +463,34 @@ SubroutineSymbol& SubroutineSymbol::fromSyntax(Compilation& compilation,
     return *result;
 }
 
+static void addLocalSlots(const Scope& scope, SmallVector<const VariableSymbol*>& slots) {
+    for (auto& member : scope.members()) {
+        if (VariableSymbol::isKind(member.kind)) {
+            slots.append(&member.as<VariableSymbol>());
+        }
+        else if (member.kind == SymbolKind::SequentialBlock) {
+            // Variables in nested blocks aren't added as members until the block's
+            // body is bound, so make sure that happens first.
+            auto& block = member.as<SequentialBlockSymbol>();
+            block.getBody();
+            addLocalSlots(block, slots);
+        }
+    }
+}
+
+void SubroutineSymbol::computeLocalSlots() const {
+    // Binding the body can add new members, so do that before walking them.
+    getBody();
+
+    SmallVectorSized<const VariableSymbol*, 16> slots;
+    addLocalSlots(*this, slots);
+
+    for (uint32_t i = 0; i < slots.size(); i++)
+        slots[i]->frameSlot = i;
+
+    localSlots = slots.copy(getCompilation());
+}
+
 void SubroutineSymbol::toJson(json& j) const {
     j["returnType"] = getReturnType();
     j["defaultLifetime"] = toString(defaultLifetime);
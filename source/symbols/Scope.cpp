@@ -121,11 +121,11 @@ const NetType& Scope::getDefaultNetType() const {
 }
 
 Diagnostic& Scope::addDiag(DiagCode code, SourceLocation location) const {
-    return compilation.diags.add(*thisSym, code, location);
+    return compilation.addDiag(*thisSym, code, location);
 }
 
 Diagnostic& Scope::addDiag(DiagCode code, SourceRange sourceRange) const {
-    return compilation.diags.add(*thisSym, code, sourceRange);
+    return compilation.addDiag(*thisSym, code, sourceRange.start()) << sourceRange;
 }
 
 void Scope::addMember(const Symbol& symbol) {
@@ -507,6 +507,9 @@ void Scope::elaborate() const {
         ASSERT(stmt);
         stmt->bindBody();
     }
+    else if (auto loop = deferredData.getGenerateLoop()) {
+        loop->createBlocks();
+    }
     else {
         // Go through deferred members and elaborate them now. We skip generate blocks in
         // the initial pass because evaluating their conditions may depend on other members
@@ -844,8 +847,19 @@ const Symbol* handleLookupSelectors(const Symbol* symbol,
                 symbol = array.elements[array.range.translateIndex(*index)];
                 break;
             }
-            case SymbolKind::GenerateBlockArray:
-                // TODO: handle this
+            case SymbolKind::GenerateBlockArray: {
+                auto block = symbol->as<GenerateBlockArraySymbol>().getEntry(*index);
+                if (!block) {
+                    auto& diag = result.addDiag(context.scope, DiagCode::ScopeIndexOutOfRange,
+                                                syntax->sourceRange());
+                    diag << *index;
+                    diag.addNote(DiagCode::NoteDeclarationHere, symbol->location);
+                    return nullptr;
+                }
+
+                symbol = block;
+                break;
+            }
             default: {
                 // I think it's safe to assume that the symbol name here will not be empty
                 // because if it was, it'd be an instance array or generate array.
@@ -1250,6 +1264,16 @@ StatementBodiedScope* Scope::DeferredMemberData::getStatement() const {
     return std::get<1>(membersOrStatement);
 }
 
+void Scope::DeferredMemberData::setGenerateLoop(GenerateBlockArraySymbol& loop) {
+    membersOrStatement = &loop;
+}
+
+GenerateBlockArraySymbol* Scope::DeferredMemberData::getGenerateLoop() const {
+    if (membersOrStatement.index() != 2)
+        return nullptr;
+    return std::get<2>(membersOrStatement);
+}
+
 void Scope::DeferredMemberData::setPortConnections(
     const SeparatedSyntaxList<PortConnectionSyntax>& connections) {
     portConns = &connections;
@@ -34,6 +34,8 @@ struct AsScopeVisitor {
 };
 
 struct ToJsonVisitor {
+    bool includeMembers = true;
+
     template<typename T>
     void visit(const T& symbol, json& j) {
         if constexpr (std::is_base_of_v<Type, T> && !std::is_same_v<TypeAliasType, T>) {
@@ -62,8 +64,10 @@ struct ToJsonVisitor {
             }
 
             if constexpr (std::is_base_of_v<Scope, T>) {
-                for (const auto& member : symbol.members())
-                    j["members"].push_back(member);
+                if (includeMembers) {
+                    for (const auto& member : symbol.members())
+                        j["members"].push_back(member);
+                }
             }
 
             if constexpr (!std::is_same_v<Symbol, T>) {
@@ -88,6 +92,59 @@ const Symbol* Symbol::findAncestor(SymbolKind searchKind) const {
     return current;
 }
 
+void Symbol::getHierarchicalPath(std::string& buffer) const {
+    const Symbol* parent = nullptr;
+    if (auto scope = getScope()) {
+        parent = &scope->asSymbol();
+        if (parent->kind == SymbolKind::Root || parent->kind == SymbolKind::CompilationUnit)
+            parent = nullptr;
+    }
+
+    if (parent) {
+        parent->getHierarchicalPath(buffer);
+        if (parent->kind == SymbolKind::Package)
+            buffer += "::";
+    }
+
+    if (!name.empty()) {
+        if (parent && parent->kind != SymbolKind::Package)
+            buffer += '.';
+        buffer += name;
+        return;
+    }
+
+    // Array elements are unnamed; they're referred to by index instead.
+    if (parent && parent->kind == SymbolKind::InstanceArray) {
+        // The elements are the only members of the array's scope and are added in
+        // order, so the position in the scope gives the offset without a search.
+        auto& array = parent->as<InstanceArraySymbol>();
+        int32_t offset = int32_t(uint32_t(getIndex())) - 1;
+        ASSERT(array.elements[offset] == this);
+        int32_t index = array.range.isLittleEndian() ? array.range.lower() + offset
+                                                     : array.range.upper() - offset;
+        buffer += '[' + std::to_string(index) + ']';
+        return;
+    }
+
+    if (parent && parent->kind == SymbolKind::GenerateBlockArray &&
+        kind == SymbolKind::GenerateBlock) {
+        buffer += '[' + std::to_string(as<GenerateBlockSymbol>().arrayIndex) + ']';
+        return;
+    }
+
+    uint32_t constructIndex;
+    if (kind == SymbolKind::GenerateBlock)
+        constructIndex = as<GenerateBlockSymbol>().constructIndex;
+    else if (kind == SymbolKind::GenerateBlockArray)
+        constructIndex = as<GenerateBlockArraySymbol>().constructIndex;
+    else
+        return;
+
+    if (parent)
+        buffer += '.';
+    buffer += "genblk" + std::to_string(constructIndex);
+}
+
 bool Symbol::isType() const {
     return Type::isKind(kind);
 }
@@ -157,4 +214,10 @@ void to_json(json& j, const Symbol& symbol) {
     symbol.visit(visitor, j);
 }
 
+void propertiesToJson(json& j, const Symbol& symbol) {
+    ToJsonVisitor visitor;
+    visitor.includeMembers = false;
+    symbol.visit(visitor, j);
+}
+
 } // namespace slang
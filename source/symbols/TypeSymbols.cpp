@@ -196,20 +196,42 @@ bool Type::isMatching(const Type& rhs) const {
     if (l == r || (l->getSyntax() && l->getSyntax() == r->getSyntax()))
         return true;
 
+    // Built-in types are only shared within a single compilation, so types that come
+    // from packages in an attached compilation need to be matched by kind instead.
     // Special casing for type synonyms: logic/reg
     if (l->isScalar() && r->isScalar()) {
-        auto ls = l->as<ScalarType>().scalarKind;
-        auto rs = r->as<ScalarType>().scalarKind;
-        return (ls == ScalarType::Logic || ls == ScalarType::Reg) &&
-               (rs == ScalarType::Logic || rs == ScalarType::Reg);
+        auto& ls = l->as<ScalarType>();
+        auto& rs = r->as<ScalarType>();
+        if (ls.scalarKind == rs.scalarKind && ls.isSigned == rs.isSigned)
+            return true;
+
+        return (ls.scalarKind == ScalarType::Logic || ls.scalarKind == ScalarType::Reg) &&
+               (rs.scalarKind == ScalarType::Logic || rs.scalarKind == ScalarType::Reg);
     }
 
     // Special casing for type synonyms: real/realtime
     if (l->isFloating() && r->isFloating()) {
         auto lf = l->as<FloatingType>().floatKind;
         auto rf = r->as<FloatingType>().floatKind;
-        return (lf == FloatingType::Real || lf == FloatingType::RealTime) &&
-               (rf == FloatingType::Real || rf == FloatingType::RealTime);
+        return lf == rf || ((lf == FloatingType::Real || lf == FloatingType::RealTime) &&
+                            (rf == FloatingType::Real || rf == FloatingType::RealTime));
+    }
+
+    if (l->isPredefinedInteger() && r->isPredefinedInteger()) {
+        auto& li = l->as<PredefinedIntegerType>();
+        auto& ri = r->as<PredefinedIntegerType>();
+        return li.integerKind == ri.integerKind && li.isSigned == ri.isSigned;
+    }
+
+    switch (l->kind) {
+        case SymbolKind::StringType:
+        case SymbolKind::CHandleType:
+        case SymbolKind::VoidType:
+        case SymbolKind::NullType:
+        case SymbolKind::EventType:
+            return l->kind == r->kind;
+        default:
+            break;
     }
 
     // Handle check (e) and (f): matching predefined integers and matching vector types
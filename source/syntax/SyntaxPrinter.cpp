@@ -114,6 +114,12 @@ std::string SyntaxPrinter::printFile(const SyntaxTree& tree) {
         .str();
 }
 
+std::string SyntaxPrinter::takeText() {
+    if (!buffer.empty())
+        lastTaken = buffer.back();
+    return std::exchange(buffer, std::string());
+}
+
 void SyntaxPrinter::append(string_view text) {
     if (!squashNewlines) {
         buffer.append(text);
@@ -135,15 +141,14 @@ void SyntaxPrinter::append(string_view text) {
             i++;
         }
 
-        for (; i < text.length(); i++) {
-            if (text[i] == '\r' || text[i] == '\n')
-                i++;
-        }
+        while (i < text.length() && (text[i] == '\r' || text[i] == '\n'))
+            i++;
 
         text = text.substr(i);
     }
 
-    if (buffer.empty() || buffer.back() != '\n') {
+    char last = buffer.empty() ? lastTaken : buffer.back();
+    if (last != '\n') {
         if (carriage)
             buffer.push_back('\r');
         if (newline)
@@ -6,10 +6,117 @@
 //------------------------------------------------------------------------------
 #include "slang/syntax/SyntaxTree.h"
 
+#include <thread>
+
 #include "slang/parsing/Parser.h"
 #include "slang/parsing/Preprocessor.h"
+#include "slang/syntax/AllSyntax.h"
 #include "slang/text/SourceManager.h"
 
+#include "../text/CharInfo.h"
+
+namespace {
+
+using namespace slang;
+
+// Buffers smaller than this aren't worth splitting up for parallel parsing.
+const size_t MinChunkSize = 1 << 20;
+
+bool isWordChar(char c) {
+    return isAlphaNumeric(c) || c == '_' || c == '$';
+}
+
+// Skips past whitespace and comments, returning the first character of anything else.
+const char* skipTrivia(const char* ptr, const char* end) {
+    while (ptr != end) {
+        if (isWhitespace(*ptr) || isNewline(*ptr))
+            ptr++;
+        else if (*ptr == '/' && ptr + 1 != end && ptr[1] == '/') {
+            while (ptr != end && !isNewline(*ptr))
+                ptr++;
+        }
+        else if (*ptr == '/' && ptr + 1 != end && ptr[1] == '*') {
+            auto close = string_view(ptr + 2, size_t(end - ptr - 2)).find("*/");
+            ptr = close == string_view::npos ? end : ptr + 2 + close + 2;
+        }
+        else
+            break;
+    }
+    return ptr;
+}
+
+// Scans source text (which must not contain any preprocessor directives) for top-level
+// `endmodule` keywords and returns the offsets just past some of them (including an
+// optional end label) such that the text is split into chunks of roughly the given size.
+// This is only a guess at where modules end; the caller is expected to verify that each
+// chunk parses cleanly on its own.
+std::vector<size_t> findChunkBoundaries(string_view text, size_t chunkSize) {
+    std::vector<size_t> results;
+    const char* begin = text.data();
+    const char* end = begin + text.size();
+    const char* ptr = begin;
+    const char* lastBoundary = begin;
+    uint32_t depth = 0;
+
+    while (ptr != end) {
+        char c = *ptr;
+        if (c == '/' && ptr + 1 != end && (ptr[1] == '/' || ptr[1] == '*')) {
+            ptr = skipTrivia(ptr, end);
+        }
+        else if (c == '"') {
+            for (ptr++; ptr != end && *ptr != '"'; ptr++) {
+                if (*ptr == '\\' && ptr + 1 != end)
+                    ptr++;
+            }
+            if (ptr != end)
+                ptr++;
+        }
+        else if (c == '\\') {
+            // escaped identifier; runs until the next whitespace
+            while (ptr != end && !isWhitespace(*ptr) && !isNewline(*ptr))
+                ptr++;
+        }
+        else if (isWordChar(c)) {
+            const char* wordStart = ptr;
+            while (ptr != end && isWordChar(*ptr))
+                ptr++;
+
+            string_view word(wordStart, size_t(ptr - wordStart));
+            if (word == "module" || word == "macromodule") {
+                depth++;
+            }
+            else if (word == "endmodule" && depth && --depth == 0) {
+                // Include the optional end label in the current chunk.
+                const char* next = skipTrivia(ptr, end);
+                if (next != end && *next == ':') {
+                    next = skipTrivia(next + 1, end);
+                    if (next != end && *next == '\\') {
+                        while (next != end && !isWhitespace(*next) && !isNewline(*next))
+                            next++;
+                    }
+                    else {
+                        while (next != end && isWordChar(*next))
+                            next++;
+                    }
+                    ptr = next;
+                }
+
+                if (size_t(ptr - lastBoundary) >= chunkSize &&
+                    size_t(end - ptr) >= chunkSize / 2) {
+                    results.push_back(size_t(ptr - begin));
+                    lastBoundary = ptr;
+                }
+            }
+        }
+        else {
+            ptr++;
+        }
+    }
+    return results;
+}
+
+} // namespace
+
 namespace slang {
 
 SyntaxTree::SyntaxTree(SyntaxNode* root, SourceManager& sourceManager, BumpAllocator&& alloc,
@@ -62,6 +169,19 @@ SyntaxTree::SyntaxTree(SyntaxNode* root, SourceManager& sourceManager, BumpAlloc
 
 std::shared_ptr<SyntaxTree> SyntaxTree::create(SourceManager& sourceManager, SourceBuffer source,
                                                const Bag& options, bool guess) {
+    auto parseOptions = options.getOrDefault<ParserOptions>();
+    if (!guess && parseOptions.numThreads > 1 && source.data.size() >= MinChunkSize * 2 &&
+        source.data.find('`') == string_view::npos) {
+
+        size_t chunkSize = std::max(MinChunkSize, source.data.size() / parseOptions.numThreads);
+        auto boundaries = findChunkBoundaries(source.data, chunkSize);
+        if (!boundaries.empty()) {
+            auto result = createChunked(sourceManager, source, options, boundaries);
+            if (result)
+                return result;
+        }
+    }
+
     BumpAllocator alloc;
     Diagnostics diagnostics;
     Preprocessor preprocessor(sourceManager, alloc, diagnostics, options);
@@ -83,4 +203,75 @@ std::shared_ptr<SyntaxTree> SyntaxTree::create(SourceManager& sourceManager, Sou
                        parser.getMetadataMap(), options, parser.getEOFToken()));
 }
 
+std::shared_ptr<SyntaxTree> SyntaxTree::createChunked(SourceManager& sourceManager,
+                                                      SourceBuffer source, const Bag& options,
+                                                      const std::vector<size_t>& boundaries) {
+    struct Chunk {
+        BumpAllocator alloc;
+        Diagnostics diagnostics;
+        Parser::MetadataMap metadataMap;
+        CompilationUnitSyntax* unit = nullptr;
+        Token eof;
+        std::exception_ptr error;
+    };
+
+    std::vector<Chunk> chunks(boundaries.size() + 1);
+    auto parseChunk = [&](size_t index) {
+        Chunk& chunk = chunks[index];
+        try {
+            Preprocessor preprocessor(sourceManager, chunk.alloc, chunk.diagnostics, options);
+            if (index == boundaries.size())
+                preprocessor.pushSource(source, boundaries[index - 1], source.data.size() - 1);
+            else
+                preprocessor.pushSource(source, index ? boundaries[index - 1] : 0,
+                                        boundaries[index]);
+
+            Parser parser(preprocessor, options);
+            chunk.unit = &parser.parseCompilationUnit();
+            chunk.metadataMap = parser.getMetadataMap();
+            chunk.eof = parser.getEOFToken();
+        }
+        catch (...) {
+            chunk.error = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < chunks.size(); i++)
+        threads.emplace_back(parseChunk, i);
+
+    parseChunk(0);
+    for (auto& thread : threads)
+        thread.join();
+
+    // If any chunk had trouble, our guess about where modules end may have been wrong
+    // (or the source is simply broken); either way let the serial parser handle it so
+    // that diagnostics come out exactly as they normally would.
+    for (auto& chunk : chunks) {
+        if (chunk.error)
+            std::rethrow_exception(chunk.error);
+        if (!chunk.diagnostics.empty())
+            return nullptr;
+    }
+
+    BumpAllocator alloc;
+    Parser::MetadataMap metadataMap;
+    SmallVectorSized<MemberSyntax*, 16> members;
+    for (auto& chunk : chunks) {
+        for (auto member : chunk.unit->members)
+            members.append(member);
+
+        for (auto& [node, value] : chunk.metadataMap)
+            metadataMap[node] = value;
+
+        alloc.steal(std::move(chunk.alloc));
+    }
+
+    Token eof = chunks.back().eof;
+    auto root = alloc.emplace<CompilationUnitSyntax>(members.copy(alloc), eof);
+    return std::shared_ptr<SyntaxTree>(new SyntaxTree(root, sourceManager, std::move(alloc),
+                                                      Diagnostics(), std::move(metadataMap),
+                                                      options, eof));
+}
+
 } // namespace slang
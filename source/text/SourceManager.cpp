@@ -15,7 +15,7 @@ namespace slang {
 SourceManager::SourceManager() {
     // add a dummy entry to the start of the directory list so that our file IDs line up
     FileInfo file;
-    bufferEntries.emplace_back(file);
+    addEntry(file);
 }
 
 std::string SourceManager::makeAbsolutePath(string_view path) const {
@@ -23,11 +23,15 @@ std::string SourceManager::makeAbsolutePath(string_view path) const {
 }
 
 void SourceManager::addSystemDirectory(string_view path) {
-    systemDirectories.push_back(fs::canonical(path));
+    auto dir = fs::canonical(path);
+    std::unique_lock lock(mut);
+    systemDirectories.push_back(std::move(dir));
 }
 
 void SourceManager::addUserDirectory(string_view path) {
-    userDirectories.push_back(fs::canonical(path));
+    auto dir = fs::canonical(path);
+    std::unique_lock lock(mut);
+    userDirectories.push_back(std::move(dir));
 }
 
 uint32_t SourceManager::getLineNumber(SourceLocation location) const {
@@ -37,6 +41,10 @@ uint32_t SourceManager::getLineNumber(SourceLocation location) const {
         return 0;
 
     FileData* fd = getFileData(fileLocation.buffer());
+    if (!fd->hasLineDirectives.load(std::memory_order_acquire))
+        return rawLineNumber;
+
+    std::shared_lock lock(mut);
     auto lineDirective = fd->getPreviousLineDirective(rawLineNumber);
 
     if (!lineDirective)
@@ -66,9 +74,10 @@ string_view SourceManager::getFileName(SourceLocation location) const {
     FileData* fd = getFileData(fileLocation.buffer());
     if (!fd)
         return "";
-    else if (fd->lineDirectives.empty())
+    else if (!fd->hasLineDirectives.load(std::memory_order_acquire))
         return string_view(fd->name);
 
+    std::shared_lock lock(mut);
     auto lineDirective = fd->getPreviousLineDirective(getRawLineNumber(fileLocation));
     if (!lineDirective)
         return string_view(fd->name);
@@ -84,15 +93,45 @@ string_view SourceManager::getRawFileName(BufferID buffer) const {
         return string_view(fd->name);
 }
 
+std::string SourceManager::getFullPath(BufferID buffer) const {
+    FileData* fd = getFileData(buffer);
+    if (!fd || !fd->directory)
+        return "";
+
+    return (*fd->directory / fs::path(fd->name).filename()).string();
+}
+
 SourceLocation SourceManager::getIncludedFrom(BufferID buffer) const {
     if (!buffer)
         return SourceLocation();
 
-    ASSERT(buffer.id < bufferEntries.size());
-    const FileInfo* info = std::get_if<FileInfo>(&bufferEntries[buffer.id]);
+    const FileInfo* info = std::get_if<FileInfo>(&getEntry(buffer));
     return info ? info->includedFrom : SourceLocation();
 }
 
+std::vector<BufferID> SourceManager::getIncludedBuffers(BufferID buffer) const {
+    std::vector<BufferID> results;
+    if (!buffer)
+        return results;
+
+    // Buffers are only ever included into buffers created before them, so everything
+    // we're looking for comes after the given buffer.
+    uint32_t count = entryCount.load(std::memory_order_acquire);
+    for (uint32_t id = buffer.getId() + 1; id < count; id++) {
+        BufferID current = BufferID::get(id);
+        if (!std::holds_alternative<FileInfo>(getEntry(current)))
+            continue;
+
+        SourceLocation includedFrom = getFullyExpandedLoc(getIncludedFrom(current));
+        while (includedFrom.buffer() && includedFrom.buffer() != buffer)
+            includedFrom = getFullyExpandedLoc(getIncludedFrom(includedFrom.buffer()));
+
+        if (includedFrom.buffer() == buffer)
+            results.push_back(current);
+    }
+    return results;
+}
+
 string_view SourceManager::getMacroName(SourceLocation location) const {
     while (isMacroArgLoc(location))
         location = getExpansionLoc(location);
@@ -101,8 +140,7 @@ string_view SourceManager::getMacroName(SourceLocation location) const {
     if (!buffer)
         return {};
 
-    ASSERT(buffer.id < bufferEntries.size());
-    auto info = std::get_if<ExpansionInfo>(&bufferEntries[buffer.id]);
+    auto info = std::get_if<ExpansionInfo>(&getEntry(buffer));
     if (!info)
         return {};
 
@@ -114,8 +152,7 @@ bool SourceManager::isFileLoc(SourceLocation location) const {
     if (!buffer)
         return false;
 
-    ASSERT(buffer.id < bufferEntries.size());
-    return std::get_if<FileInfo>(&bufferEntries[buffer.id]) != nullptr;
+    return std::get_if<FileInfo>(&getEntry(buffer)) != nullptr;
 }
 
 bool SourceManager::isMacroLoc(SourceLocation location) const {
@@ -123,8 +160,7 @@ bool SourceManager::isMacroLoc(SourceLocation location) const {
     if (!buffer)
         return false;
 
-    ASSERT(buffer.id < bufferEntries.size());
-    return std::get_if<ExpansionInfo>(&bufferEntries[buffer.id]) != nullptr;
+    return std::get_if<ExpansionInfo>(&getEntry(buffer)) != nullptr;
 }
 
 bool SourceManager::isMacroArgLoc(SourceLocation location) const {
@@ -132,8 +168,7 @@ bool SourceManager::isMacroArgLoc(SourceLocation location) const {
     if (!buffer)
         return false;
 
-    ASSERT(buffer.id < bufferEntries.size());
-    auto info = std::get_if<ExpansionInfo>(&bufferEntries[buffer.id]);
+    auto info = std::get_if<ExpansionInfo>(&getEntry(buffer));
     return info && info->isMacroArg;
 }
 
@@ -190,8 +225,7 @@ SourceLocation SourceManager::getExpansionLoc(SourceLocation location) const {
     if (!buffer)
         return SourceLocation();
 
-    ASSERT(buffer.id < bufferEntries.size());
-    return std::get<ExpansionInfo>(bufferEntries[buffer.id]).expansionStart;
+    return std::get<ExpansionInfo>(getEntry(buffer)).expansionStart;
 }
 
 SourceRange SourceManager::getExpansionRange(SourceLocation location) const {
@@ -199,8 +233,7 @@ SourceRange SourceManager::getExpansionRange(SourceLocation location) const {
     if (!buffer)
         return SourceRange();
 
-    ASSERT(buffer.id < bufferEntries.size());
-    const ExpansionInfo& info = std::get<ExpansionInfo>(bufferEntries[buffer.id]);
+    const ExpansionInfo& info = std::get<ExpansionInfo>(getEntry(buffer));
     return SourceRange(info.expansionStart, info.expansionEnd);
 }
 
@@ -209,9 +242,7 @@ SourceLocation SourceManager::getOriginalLoc(SourceLocation location) const {
     if (!buffer)
         return SourceLocation();
 
-    ASSERT(buffer.id < bufferEntries.size());
-    return std::get<ExpansionInfo>(bufferEntries[buffer.id]).originalLoc +
-           (size_t)location.offset();
+    return std::get<ExpansionInfo>(getEntry(buffer)).originalLoc + (size_t)location.offset();
 }
 
 SourceLocation SourceManager::getFullyOriginalLoc(SourceLocation location) const {
@@ -241,18 +272,18 @@ string_view SourceManager::getSourceText(BufferID buffer) const {
 SourceLocation SourceManager::createExpansionLoc(SourceLocation originalLoc,
                                                  SourceLocation expansionStart,
                                                  SourceLocation expansionEnd, bool isMacroArg) {
-    bufferEntries.emplace_back(
-        ExpansionInfo(originalLoc, expansionStart, expansionEnd, isMacroArg));
-    return SourceLocation(BufferID::get((uint32_t)(bufferEntries.size() - 1)), 0);
+    std::unique_lock lock(mut);
+    return SourceLocation(
+        addEntry(ExpansionInfo(originalLoc, expansionStart, expansionEnd, isMacroArg)), 0);
 }
 
 SourceLocation SourceManager::createExpansionLoc(SourceLocation originalLoc,
                                                  SourceLocation expansionStart,
                                                  SourceLocation expansionEnd,
                                                  string_view macroName) {
-
-    bufferEntries.emplace_back(ExpansionInfo(originalLoc, expansionStart, expansionEnd, macroName));
-    return SourceLocation(BufferID::get((uint32_t)(bufferEntries.size() - 1)), 0);
+    std::unique_lock lock(mut);
+    return SourceLocation(
+        addEntry(ExpansionInfo(originalLoc, expansionStart, expansionEnd, macroName)), 0);
 }
 
 SourceBuffer SourceManager::assignText(string_view text, SourceLocation includedFrom) {
@@ -278,8 +309,9 @@ SourceBuffer SourceManager::assignText(string_view path, string_view text,
 
 SourceBuffer SourceManager::assignBuffer(string_view path, std::vector<char>&& buffer,
                                          SourceLocation includedFrom) {
-    userFileBuffers.emplace_back(FileData(nullptr, std::string(path), std::move(buffer)));
-    return createBufferEntry(&userFileBuffers.back(), includedFrom);
+    std::unique_lock lock(mut);
+    auto& fd = userFileBuffers.emplace_back(nullptr, std::string(path), std::move(buffer));
+    return createBufferEntry(&fd, includedFrom);
 }
 
 SourceBuffer SourceManager::readSource(string_view path) {
@@ -295,26 +327,30 @@ SourceBuffer SourceManager::readHeader(string_view path, SourceLocation included
     if (p.is_absolute())
         return openCached(p, includedFrom);
 
-    // system path lookups only look in system directories
-    if (isSystemPath) {
-        for (auto& d : systemDirectories) {
-            SourceBuffer result = openCached(d / p, includedFrom);
-            if (result.id)
-                return result;
-        }
-        return SourceBuffer();
+    // Take copies of the search paths so that we don't hold the lock while searching.
+    // Directory pointers stay valid once created, so the current file's one is safe.
+    std::vector<fs::path> searchDirs;
+    const fs::path* currentDir = nullptr;
+    if (!isSystemPath) {
+        FileData* fd = getFileData(includedFrom.buffer());
+        if (fd)
+            currentDir = fd->directory;
+    }
+
+    {
+        std::shared_lock lock(mut);
+        searchDirs = isSystemPath ? systemDirectories : userDirectories;
     }
 
-    // search relative to the current file
-    FileData* fd = getFileData(includedFrom.buffer());
-    if (fd && fd->directory) {
-        SourceBuffer result = openCached((*fd->directory) / p, includedFrom);
+    // search relative to the current file (for non-system includes)
+    if (currentDir) {
+        SourceBuffer result = openCached(*currentDir / p, includedFrom);
         if (result.id)
             return result;
     }
 
     // search additional include directories
-    for (auto& d : userDirectories) {
+    for (auto& d : searchDirs) {
         SourceBuffer result = openCached(d / p, includedFrom);
         if (result.id)
             return result;
@@ -323,6 +359,22 @@ SourceBuffer SourceManager::readHeader(string_view path, SourceLocation included
     return SourceBuffer();
 }
 
+void SourceManager::invalidateFile(string_view path) {
+    std::error_code ec;
+    fs::path absPath = fs::canonical(path, ec);
+    if (ec)
+        return;
+
+    std::unique_lock lock(mut);
+    auto it = lookupCache.find(absPath.string());
+    if (it == lookupCache.end())
+        return;
+
+    if (it->second)
+        invalidatedFiles.push_back(std::move(it->second));
+    lookupCache.erase(it);
+}
+
 void SourceManager::addLineDirective(SourceLocation location, uint32_t lineNum, string_view name,
                                      uint8_t level) {
     SourceLocation fileLocation = getFullyExpandedLoc(location);
@@ -338,22 +390,57 @@ void SourceManager::addLineDirective(SourceLocation location, uint32_t lineNum,
         full = fs::path(fd->name).replace_filename(linePath);
 
     uint32_t sourceLineNum = getRawLineNumber(fileLocation);
+
+    std::unique_lock lock(mut);
     fd->lineDirectives.emplace_back(full.string(), sourceLineNum, lineNum, level);
+    fd->hasLineDirectives.store(true, std::memory_order_release);
+}
+
+const SourceManager::BufferEntry& SourceManager::getEntry(BufferID buffer) const {
+    ASSERT(buffer.id < entryCount.load(std::memory_order_acquire));
+    BufferEntry** table = entryTable.load(std::memory_order_acquire);
+    return table[buffer.id >> EntryChunkBits][buffer.id & (EntryChunkSize - 1)];
 }
 
 SourceManager::FileData* SourceManager::getFileData(BufferID buffer) const {
     if (!buffer)
         return nullptr;
 
-    ASSERT(buffer.id < bufferEntries.size());
-    return std::get<FileInfo>(bufferEntries[buffer.id]).data;
+    return std::get<FileInfo>(getEntry(buffer)).data;
+}
+
+BufferID SourceManager::addEntry(BufferEntry&& entry) {
+    uint32_t id = entryCount.load(std::memory_order_relaxed);
+    size_t chunk = id >> EntryChunkBits;
+    if (chunk == entryChunks.size()) {
+        if (chunk == entryTableSize) {
+            size_t newSize = entryTableSize ? entryTableSize * 2 : 16;
+            auto newTable = std::make_unique<BufferEntry*[]>(newSize);
+            if (entryTableSize)
+                std::copy_n(entryTables.back().get(), entryTableSize, newTable.get());
+
+            entryTable.store(newTable.get(), std::memory_order_release);
+            entryTables.push_back(std::move(newTable));
+            entryTableSize = newSize;
+        }
+
+        // Chunk memory is left uninitialized until entries are appended to it.
+        auto& storage = entryChunks.emplace_back(
+            new std::byte[EntryChunkSize * sizeof(BufferEntry)]);
+        entryTables.back()[chunk] = reinterpret_cast<BufferEntry*>(storage.get());
+    }
+
+    // Fill in the entry before publishing the new count, so that a reader that sees the
+    // count (or is handed the new ID) also sees a complete entry.
+    new (entryTables.back()[chunk] + (id & (EntryChunkSize - 1))) BufferEntry(std::move(entry));
+    entryCount.store(id + 1, std::memory_order_release);
+    return BufferID::get(id);
 }
 
 SourceBuffer SourceManager::createBufferEntry(FileData* fd, SourceLocation includedFrom) {
     ASSERT(fd);
-    bufferEntries.emplace_back(FileInfo(fd, includedFrom));
     return SourceBuffer{ string_view(fd->mem.data(), fd->mem.size()),
-                         BufferID::get((uint32_t)(bufferEntries.size() - 1)) };
+                         addEntry(FileInfo(fd, includedFrom)) };
 }
 
 SourceBuffer SourceManager::openCached(const fs::path& fullPath, SourceLocation includedFrom) {
@@ -363,17 +450,21 @@ SourceBuffer SourceManager::openCached(const fs::path& fullPath, SourceLocation
         return SourceBuffer();
 
     // first see if we have this file cached
-    auto it = lookupCache.find(absPath.string());
-    if (it != lookupCache.end()) {
-        FileData* fd = it->second.get();
-        if (!fd)
-            return SourceBuffer();
-        return createBufferEntry(fd, includedFrom);
+    {
+        std::unique_lock lock(mut);
+        auto it = lookupCache.find(absPath.string());
+        if (it != lookupCache.end()) {
+            FileData* fd = it->second.get();
+            if (!fd)
+                return SourceBuffer();
+            return createBufferEntry(fd, includedFrom);
+        }
     }
 
-    // do the read
+    // do the read without holding the lock, so that other threads can keep going
     std::vector<char> buffer;
     if (!readFile(absPath, buffer)) {
+        std::unique_lock lock(mut);
         lookupCache.emplace(absPath.string(), nullptr);
         return SourceBuffer();
     }
@@ -391,10 +482,18 @@ SourceBuffer SourceManager::cacheBuffer(const fs::path& path, SourceLocation inc
     else
         name = rel.string();
 
+    std::unique_lock lock(mut);
+
+    // Another thread may have loaded the same file while we were reading it.
+    auto it = lookupCache.find(path.string());
+    if (it != lookupCache.end() && it->second)
+        return createBufferEntry(it->second.get(), includedFrom);
+
     auto fd = std::make_unique<FileData>(&*directories.insert(path.parent_path()).first,
                                          std::move(name), std::move(buffer));
 
-    FileData* fdPtr = lookupCache.emplace(path.string(), std::move(fd)).first->second.get();
+    FileData* fdPtr = fd.get();
+    lookupCache[path.string()] = std::move(fd);
     return createBufferEntry(fdPtr, includedFrom);
 }
 
@@ -466,8 +565,7 @@ uint32_t SourceManager::getRawLineNumber(SourceLocation location) const {
         return 0;
 
     // compute line offsets if we haven't already
-    if (fd->lineOffsets.empty())
-        computeLineOffsets(fd->mem, fd->lineOffsets);
+    std::call_once(fd->lineOffsetsFlag, [fd] { computeLineOffsets(fd->mem, fd->lineOffsets); });
 
     // Find the first line offset that is greater than the given location offset. That iterator
     // then tells us how many lines away from the beginning we are.
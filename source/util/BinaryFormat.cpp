@@ -0,0 +1,89 @@
+//------------------------------------------------------------------------------
+// BinaryFormat.cpp
+// Helpers shared by the compact binary file formats.
+//
+// File is under the MIT license; see LICENSE for details.
+//------------------------------------------------------------------------------
+#include "slang/util/BinaryFormat.h"
+
+#include <fmt/format.h>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+
+namespace slang {
+
+void BinaryFormat::writeHeader(std::ostream& stream) const {
+    stream.write(magic.data(), std::streamsize(magic.size()));
+    writeVarInt(stream, version);
+}
+
+void BinaryFormat::readHeader(std::istream& stream) const {
+    std::string buffer(magic.size(), '\0');
+    if (!stream.read(buffer.data(), std::streamsize(buffer.size())) || buffer != magic)
+        wrongFormat();
+
+    if (readVarInt(stream) != version)
+        wrongVersion();
+}
+
+uint64_t BinaryFormat::readVarInt(std::istream& stream) const {
+    uint64_t result = 0;
+    for (uint32_t shift = 0; shift < 64; shift += 7) {
+        int byte = stream.get();
+        if (byte == std::char_traits<char>::eof())
+            malformed();
+
+        result |= uint64_t(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+            return result;
+    }
+    malformed();
+}
+
+uint64_t BinaryFormat::readVarInt(string_view buffer, size_t& offset) const {
+    uint64_t result = 0;
+    for (uint32_t shift = 0; shift < 64; shift += 7) {
+        if (offset >= buffer.size())
+            malformed();
+
+        uint8_t byte = uint8_t(buffer[offset++]);
+        result |= uint64_t(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+            return result;
+    }
+    malformed();
+}
+
+void BinaryFormat::malformed() const {
+    throw std::runtime_error(fmt::format("Malformed {} data", name));
+}
+
+void BinaryFormat::wrongFormat() const {
+    throw std::runtime_error(fmt::format("Not a {} file", name));
+}
+
+void BinaryFormat::wrongVersion() const {
+    throw std::runtime_error(fmt::format("Unsupported {} format version", name));
+}
+
+void BinaryFormat::appendVarInt(std::string& buffer, uint64_t value) {
+    while (value >= 0x80) {
+        buffer.push_back(char((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    buffer.push_back(char(value));
+}
+
+void BinaryFormat::writeVarInt(std::ostream& stream, uint64_t value) {
+    char buffer[10];
+    size_t size = 0;
+    while (value >= 0x80) {
+        buffer[size++] = char((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    buffer[size++] = char(value);
+    stream.write(buffer, std::streamsize(size));
+}
+
+} // namespace slang
@@ -29,4 +29,14 @@ uint64_t xxhash64(const void* input, size_t len, uint64_t seed) {
     return XXH64(input, len, seed);
 }
 
+uint64_t fnv1a64(const void* input, size_t len) {
+    auto bytes = static_cast<const uint8_t*>(input);
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
 } // namespace slang
\ No newline at end of file
@@ -257,4 +257,132 @@ source:2:18: note: expanded from macro 'FOO'
 `define FOO(abc) abc
                  ^~~
 )");
-}
\ No newline at end of file
+}
+
+TEST_CASE("Streaming diagnostic reports") {
+    auto& sm = getSourceManager();
+    std::string text;
+    for (int i = 0; i < 100; i++)
+        text += "`undef\n";
+
+    auto outer = sm.assignText("outer.sv", text);
+    auto inner = sm.assignText(text, SourceLocation(outer.id, 0));
+
+    // Alternate between files in blocks that straddle the writer's chunks, so that
+    // include stacks have to be printed at chunk boundaries too.
+    Diagnostics diags;
+    for (int block = 0; block < 12; block++) {
+        auto buffer = (block % 2) ? inner : outer;
+        for (uint32_t i = 0; i < 100; i++)
+            diags.add(DiagCode::ExpectedIdentifier, SourceLocation(buffer.id, i * 7 + 6));
+    }
+
+    DiagnosticWriter writer(sm);
+    std::string expected = writer.report(diags);
+    CHECK(expected.find("in file included from outer.sv:1:") != std::string::npos);
+
+    // Two threads keep fewer chunks in flight than there are in total.
+    for (uint32_t numThreads : { 1u, 2u, 3u }) {
+        std::string result;
+        int calls = 0;
+        writer.report(
+            diags,
+            [&](std::string&& chunk) {
+                result += chunk;
+                calls++;
+            },
+            numThreads);
+
+        CHECK(result == expected);
+        CHECK(calls > 1);
+    }
+
+    // If the sink fails, the workers stop and the error reaches the caller.
+    auto failingSink = [](std::string&&) { throw std::runtime_error("disk full"); };
+    CHECK_THROWS_AS(writer.report(diags, failingSink, 2), std::runtime_error);
+}
+
+TEST_CASE("Duplicate diagnostics across instances") {
+    auto tree = SyntaxTree::fromText(R"(
+module leaf #(parameter int P = 0);
+    int a = foo;
+    if (P) begin : g
+        int b = bar;
+    end
+endmodule
+
+module top;
+    leaf #(0) l0();
+    for (genvar i = 0; i < 20; i++) begin : gen
+        leaf #(1) l();
+    end
+endmodule
+)",
+                                     "source");
+
+    Compilation compilation;
+    compilation.addSyntaxTree(tree);
+
+    // One copy of each, even though the block containing 'bar' was uninstantiated in some
+    // instances and instantiated in others.
+    auto& diags = compilation.getAllDiagnostics();
+    REQUIRE(diags.size() == 2);
+    CHECK(diags[0].code == DiagCode::UndeclaredIdentifier);
+    CHECK(diags[0].symbol->kind == SymbolKind::Definition);
+    CHECK(diags[1].code == DiagCode::UndeclaredIdentifier);
+    CHECK(diags[1].symbol->kind == SymbolKind::GenerateBlock);
+}
+
+TEST_CASE("Diagnostic limits") {
+    auto tree = SyntaxTree::fromText(R"(
+module leaf #(parameter int P = 0);
+    int a = foo + P;
+    int b = bar + P;
+endmodule
+
+module top;
+    int x = baz;
+    nope n();
+    for (genvar i = 0; i < 10; i++) begin : gen
+        leaf #(i) l();
+    end
+endmodule
+)",
+                                     "source");
+
+    auto compile = [&](CompilationOptions coptions) {
+        auto compilation = std::make_unique<Compilation>(makeOptions(coptions));
+        compilation->addSyntaxTree(tree);
+        compilation->getAllDiagnostics();
+        return compilation;
+    };
+
+    auto unlimited = compile({});
+    CHECK(unlimited->getAllDiagnostics().size() == 4);
+    CHECK(unlimited->getDiagnosticCounts()[DiagCode::UndeclaredIdentifier] == 3);
+    CHECK(!unlimited->errorLimitReached());
+
+    CompilationOptions coptions;
+    coptions.errorLimit = 2;
+    auto limited = compile(coptions);
+    CHECK(limited->getAllDiagnostics().size() == 2);
+    CHECK(limited->getDiagnosticCounts()[DiagCode::UndeclaredIdentifier] == 3);
+    CHECK(limited->errorLimitReached());
+    CHECK(!limited->isAborting());
+
+    coptions.errorLimit = 0;
+    coptions.maxDiagsPerCode = 1;
+    CHECK(compile(coptions)->getAllDiagnostics().size() == 2);
+
+    // Once the limit is hit, no further instances get elaborated.
+    coptions.maxDiagsPerCode = 0;
+    coptions.errorLimit = 1;
+    coptions.abortOnErrorLimit = true;
+    auto aborted = compile(coptions);
+    CHECK(aborted->getAllDiagnostics().size() == 1);
+    CHECK(aborted->isAborting());
+    auto& top = aborted->getRoot().find<ModuleInstanceSymbol>("top");
+    auto& gen = top.find<GenerateBlockArraySymbol>("gen");
+    REQUIRE(!gen.getEntries().empty());
+    CHECK(!gen.getEntries()[0]->find("l"));
+}
@@ -157,6 +157,39 @@ endfunction
     NO_SESSION_ERRORS;
 }
 
+TEST_CASE("Eval recursive function") {
+    ScriptSession session;
+    session.eval(R"(
+function automatic int factorial(int n);
+    if (n <= 1)
+        return 1;
+    else
+        return n * factorial(n - 1);
+endfunction
+)");
+
+    session.eval(R"(
+function automatic int sum_factorials(int n);
+    int total = 0;
+    for (int i = 1; i <= n; i += 1) begin
+        total += factorial(i);
+    end
+    return total;
+endfunction
+)");
+
+    auto value = session.eval("factorial(10)");
+    CHECK(value.integer() == 3628800);
+
+    value = session.eval("sum_factorials(5)");
+    CHECK(value.integer() == 153);
+
+    // Repeated calls should see fresh locals each time.
+    value = session.eval("sum_factorials(3)");
+    CHECK(value.integer() == 9);
+    NO_SESSION_ERRORS;
+}
+
 TEST_CASE("Integer operators") {
     ScriptSession session;
 
@@ -560,4 +593,146 @@ TEST_CASE("Dynamic string ops") {
     CHECK(session.eval("str2 = {\"Hi\", \"Bye\"}").str() == "HiBye");
 
     NO_SESSION_ERRORS;
-}
\ No newline at end of file
+}
+
+TEST_CASE("Constant function memoization") {
+    auto tree = SyntaxTree::fromText(R"(
+package p;
+    parameter int SCALE = 3;
+
+    function automatic int calc_width(int n);
+        int result = 0;
+        for (int i = 0; i < n; i += 1)
+            result += 2;
+        return result;
+    endfunction
+
+    function automatic int scaled(int n);
+        return n * SCALE;
+    endfunction
+endpackage
+
+module leaf #(parameter int N = 4);
+    localparam int W = p::calc_width(N);
+    localparam int S = p::scaled(N);
+endmodule
+
+module top;
+    leaf #(4) l0();
+    leaf #(4) l1();
+    leaf #(4) l2();
+    leaf #(5) l3();
+endmodule
+)",
+                                     "source");
+
+    // l0, l1 and l2 each evaluate their own parameters, making the same calls.
+    CompilationOptions coptions;
+    coptions.memoizeConstantFunctions = true;
+
+    Compilation compilation(makeOptions(coptions));
+    auto& top = evalModule(tree, compilation);
+    NO_COMPILATION_ERRORS;
+
+    auto getValue = [&](string_view instance, string_view param) {
+        auto& leaf = top.find<ModuleInstanceSymbol>(instance);
+        return leaf.find<ParameterSymbol>(param).getValue().integer();
+    };
+    CHECK(getValue("l2", "W") == 8);
+    CHECK(getValue("l3", "W") == 10);
+    CHECK(getValue("l2", "S") == 12);
+    CHECK(getValue("l3", "S") == 15);
+
+    // Each distinct call is evaluated once, and the repeated instances hit the cache.
+    auto stats = compilation.getConstantFunctionCacheStats();
+    CHECK(stats.entries == 4);
+    CHECK(stats.misses == 4);
+    CHECK(stats.hits >= 4);
+}
+
+static bool hasDiagOrNote(const Diagnostics& diags, DiagCode code) {
+    for (auto& diag : diags) {
+        if (diag.code == code)
+            return true;
+        for (auto& note : diag.notes) {
+            if (note.code == code)
+                return true;
+        }
+    }
+    return false;
+}
+
+TEST_CASE("Constant evaluation limits") {
+    auto tree = SyntaxTree::fromText(R"(
+module m;
+    function automatic int spin(int n);
+        for (int i = 0; i < n; i += 0)
+            n += 1;
+        return n;
+    endfunction
+
+    function automatic int recurse(int n);
+        return recurse(n + 1);
+    endfunction
+
+    localparam int A = spin(1);
+    localparam int B = recurse(0);
+endmodule
+)",
+                                     "source");
+
+    CompilationOptions coptions;
+    coptions.maxConstexprSteps = 1000;
+    coptions.maxConstexprDepth = 32;
+
+    Compilation compilation(makeOptions(coptions));
+    auto& m = evalModule(tree, compilation);
+    CHECK(m.find<ParameterSymbol>("A").getValue().bad());
+    CHECK(m.find<ParameterSymbol>("B").getValue().bad());
+
+    auto& diags = compilation.getAllDiagnostics();
+    CHECK(hasDiagOrNote(diags, DiagCode::NoteExceededMaxSteps));
+    CHECK(hasDiagOrNote(diags, DiagCode::NoteExceededMaxCallDepth));
+    CHECK(hasDiagOrNote(diags, DiagCode::NoteSkippedFrames));
+}
+
+TEST_CASE("Constant function profiling") {
+    auto tree = SyntaxTree::fromText(R"(
+module m;
+    function automatic int count(int n);
+        int result = 0;
+        for (int i = 0; i < n; i += 1)
+            result += 1;
+        return result;
+    endfunction
+
+    localparam int A = count(3);
+    localparam int B = count(5);
+endmodule
+)",
+                                     "source");
+
+    CompilationOptions coptions;
+    coptions.profileConstantFunctions = true;
+
+    Compilation compilation(makeOptions(coptions));
+    auto& m = evalModule(tree, compilation);
+    NO_COMPILATION_ERRORS;
+    CHECK(m.find<ParameterSymbol>("B").getValue().integer() == 5);
+
+    // There is one profile entry per function and call site; the definition and the
+    // top-level instance each have their own copy of the function.
+    auto profile = compilation.getConstantCallProfile();
+    REQUIRE(!profile.empty());
+
+    for (auto& entry : profile) {
+        CHECK(entry.subroutine->name == "count");
+        CHECK(entry.calls >= 1);
+        CHECK(entry.expressions > 0);
+
+        // Each call executes one more iteration than its argument, for the final check.
+        CHECK(entry.loopIterations % entry.calls == 0);
+        uint64_t iterations = entry.loopIterations / entry.calls;
+        CHECK((iterations == 4 || iterations == 6));
+    }
+}
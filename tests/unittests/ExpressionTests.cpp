@@ -1,5 +1,9 @@
 #include "Test.h"
 
+#include <chrono>
+#include <fmt/format.h>
+
+#include "slang/binding/CompactExpression.h"
 #include "slang/compilation/Compilation.h"
 #include "slang/syntax/SyntaxTree.h"
 
@@ -394,4 +398,187 @@ endmodule
     REQUIRE(diags.size() == 2);
     CHECK(diags[0].code == DiagCode::NoImplicitConversion);
     CHECK(diags[1].code == DiagCode::NoImplicitConversion);
-}
\ No newline at end of file
+}
+
+TEST_CASE("Expression binding cache") {
+    auto tree = SyntaxTree::fromText(R"(
+package p;
+    parameter int W = 8;
+endpackage
+
+module leaf #(parameter int N = 1);
+    int a = p::W * 2 + 1;
+    int b = N + 1;
+    logic [p::W-1:0] c;
+endmodule
+
+module top;
+    leaf #(1) l0();
+    leaf #(2) l1();
+endmodule
+)");
+
+    auto getInit = [](const RootSymbol& root, string_view name) {
+        return root.lookupName<VariableSymbol>(name).getDeclaredType()->getInitializer();
+    };
+
+    Compilation compilation;
+    compilation.addSyntaxTree(tree);
+    NO_COMPILATION_ERRORS;
+
+    // Expressions that don't depend on the instance are only bound once.
+    auto& root = compilation.getRoot();
+    CHECK(getInit(root, "top.l0.a") == getInit(root, "top.l1.a"));
+    CHECK(getInit(root, "top.l1.a")->constant->integer() == 17);
+    CHECK(getInit(root, "top.l0.b") != getInit(root, "top.l1.b"));
+    CHECK(getInit(root, "top.l1.b")->constant->integer() == 3);
+    CHECK(root.lookupName<VariableSymbol>("top.l1.c").getType().getBitWidth() == 8);
+
+    CompilationOptions coptions;
+    coptions.cacheExpressionBinding = false;
+
+    Compilation compilation2(makeOptions(coptions));
+    compilation2.addSyntaxTree(tree);
+
+    auto& root2 = compilation2.getRoot();
+    CHECK(getInit(root2, "top.l0.a") != getInit(root2, "top.l1.a"));
+    CHECK(getInit(root2, "top.l1.a")->constant->integer() == 17);
+}
+
+namespace {
+
+// Counts named value references by walking the expression pointer graph.
+size_t countNamedValues(const Expression& expr) {
+    switch (expr.kind) {
+        case ExpressionKind::NamedValue:
+            return 1;
+        case ExpressionKind::UnaryOp:
+            return countNamedValues(expr.as<UnaryExpression>().operand());
+        case ExpressionKind::BinaryOp:
+            return countNamedValues(expr.as<BinaryExpression>().left()) +
+                   countNamedValues(expr.as<BinaryExpression>().right());
+        case ExpressionKind::ConditionalOp:
+            return countNamedValues(expr.as<ConditionalExpression>().pred()) +
+                   countNamedValues(expr.as<ConditionalExpression>().left()) +
+                   countNamedValues(expr.as<ConditionalExpression>().right());
+        case ExpressionKind::Assignment:
+            return countNamedValues(expr.as<AssignmentExpression>().left()) +
+                   countNamedValues(expr.as<AssignmentExpression>().right());
+        case ExpressionKind::Concatenation: {
+            size_t count = 0;
+            for (auto operand : expr.as<ConcatenationExpression>().operands())
+                count += countNamedValues(*operand);
+            return count;
+        }
+        case ExpressionKind::ElementSelect:
+            return countNamedValues(expr.as<ElementSelectExpression>().value()) +
+                   countNamedValues(expr.as<ElementSelectExpression>().selector());
+        case ExpressionKind::RangeSelect:
+            return countNamedValues(expr.as<RangeSelectExpression>().value()) +
+                   countNamedValues(expr.as<RangeSelectExpression>().left()) +
+                   countNamedValues(expr.as<RangeSelectExpression>().right());
+        case ExpressionKind::Conversion:
+            return countNamedValues(expr.as<ConversionExpression>().operand());
+        default:
+            return 0;
+    }
+}
+
+std::string makeAssigns(int count) {
+    std::string text = "module m; logic [7:0] a, b, c; logic [15:0] d;\n";
+    for (int i = 0; i < count; i++) {
+        text += fmt::format("logic [15:0] x{0};\n", i);
+        text += fmt::format("assign x{0} = a ? {{b, c[3:0] + a}} : ~d ^ (b * {0});\n", i);
+    }
+    return text + "endmodule";
+}
+
+} // namespace
+
+TEST_CASE("Compact expression encoding") {
+    auto tree = SyntaxTree::fromText(makeAssigns(3));
+    Compilation compilation;
+    compilation.addSyntaxTree(tree);
+    NO_COMPILATION_ERRORS;
+
+    CompactExpressionSet set;
+    std::vector<const Expression*> assigns;
+    auto& instance = *compilation.getRoot().topInstances[0];
+    for (auto& assign : instance.membersOfType<ContinuousAssignSymbol>()) {
+        assigns.push_back(&assign.getAssignment());
+        set.add(assign.getAssignment());
+    }
+    REQUIRE(set.roots().size() == 3);
+
+    // Every child comes before its parent, and each tree covers a contiguous range.
+    uint32_t start = 0;
+    for (uint32_t root : set.roots()) {
+        CHECK(set.treeStart(root) == start);
+        for (uint32_t i = start; i <= root; i++) {
+            for (uint32_t child : set.children(set[i]))
+                CHECK((child >= start && child < i));
+        }
+        start = root + 1;
+    }
+    CHECK(start == set.size());
+
+    auto& root = set[set.roots()[1]];
+    CHECK(root.kind == ExpressionKind::Assignment);
+    CHECK(root.expr == assigns[1]);
+    CHECK(set[set.children(root)[0]].kind == ExpressionKind::NamedValue);
+
+    size_t named = 0;
+    for (auto& node : set) {
+        if (node.kind == ExpressionKind::NamedValue)
+            named++;
+    }
+
+    size_t expected = 0;
+    for (auto assign : assigns)
+        expected += countNamedValues(*assign);
+    CHECK(named == expected);
+}
+
+TEST_CASE("Compact expression traversal benchmark", "[.benchmark]") {
+    auto tree = SyntaxTree::fromText(makeAssigns(20000));
+    Compilation compilation;
+    compilation.addSyntaxTree(tree);
+    NO_COMPILATION_ERRORS;
+
+    std::vector<const Expression*> assigns;
+    CompactExpressionSet set;
+    auto& instance = *compilation.getRoot().topInstances[0];
+    for (auto& assign : instance.membersOfType<ContinuousAssignSymbol>()) {
+        assigns.push_back(&assign.getAssignment());
+        set.add(assign.getAssignment());
+    }
+
+    const int Iterations = 50;
+    auto time = [&](auto&& func) {
+        auto start = std::chrono::steady_clock::now();
+        size_t result = 0;
+        for (int i = 0; i < Iterations; i++)
+            result += func();
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        double ms = std::chrono::duration<double, std::milli>(elapsed).count();
+        return std::make_pair(result, ms / Iterations);
+    };
+
+    auto pointers = time([&] {
+        size_t count = 0;
+        for (auto assign : assigns)
+            count += countNamedValues(*assign);
+        return count;
+    });
+
+    auto compact = time([&] {
+        size_t count = 0;
+        for (auto& node : set)
+            count += node.kind == ExpressionKind::NamedValue;
+        return count;
+    });
+
+    CHECK(pointers.first == compact.first);
+    WARN(fmt::format("{} nodes: pointer graph {:.3f} ms, compact encoding {:.3f} ms", set.size(),
+                     pointers.second, compact.second));
+}
@@ -1,5 +1,9 @@
 #include "Test.h"
 
+#include <thread>
+
+#include "slang/syntax/SyntaxPrinter.h"
+
 std::string getTestInclude() {
     return findTestDir() + "/include.svh";
 }
@@ -68,3 +72,81 @@ TEST_CASE("Read header (include dirs)") {
     buffer = manager.readHeader("../infinite_chain.svh", SourceLocation(buffer.id, 0), false);
     CHECK(buffer);
 }
+
+TEST_CASE("Concurrent preprocessing") {
+    SourceManager manager;
+    manager.addUserDirectory(string_view(manager.makeAbsolutePath(string_view(findTestDir()))));
+
+    auto& text = "`define FOO(x) x + x\n`include \"include.svh\"\n`FOO(1)\n";
+
+    // Several preprocessors share one source manager; each one reads headers,
+    // creates buffers and expansion locations, and queries line numbers.
+    std::vector<std::string> results(4);
+    std::vector<uint32_t> lines(results.size());
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < results.size(); i++) {
+        threads.emplace_back([&, i] {
+            BumpAllocator localAlloc;
+            Diagnostics localDiags;
+            for (int j = 0; j < 20; j++) {
+                Preprocessor pp(manager, localAlloc, localDiags);
+                pp.pushSource(manager.assignText(text));
+
+                SyntaxPrinter printer;
+                while (true) {
+                    Token token = pp.next();
+                    printer.print(token);
+                    if (token.kind == TokenKind::IntegerLiteral)
+                        lines[i] = manager.getLineNumber(token.location());
+                    if (token.kind == TokenKind::EndOfFile)
+                        break;
+                }
+                results[i] = printer.str();
+            }
+        });
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+
+    CHECK(!results[0].empty());
+    for (size_t i = 0; i < results.size(); i++) {
+        CHECK(results[i] == results[0]);
+        CHECK(lines[i] == 3);
+    }
+}
+
+TEST_CASE("Included buffers and invalidation") {
+    SourceManager manager;
+    manager.addUserDirectory(string_view(manager.makeAbsolutePath(string_view(findTestDir()))));
+
+    BumpAllocator localAlloc;
+    Diagnostics localDiags;
+    Preprocessor pp(manager, localAlloc, localDiags);
+
+    auto buffer = manager.assignText("`include \"file_uses_defn.svh\"\n`FOO\n");
+    pp.pushSource(buffer);
+    while (pp.next().kind != TokenKind::EndOfFile) {
+    }
+    CHECK(manager.getFullPath(buffer.id).empty());
+
+    // Both the directly included file and the one it includes are found.
+    auto included = manager.getIncludedBuffers(buffer.id);
+    REQUIRE(included.size() == 2);
+    std::string usesPath = manager.getFullPath(included[0]);
+    std::string defnPath = manager.getFullPath(included[1]);
+    CHECK(usesPath == manager.makeAbsolutePath(findTestDir() + "/file_uses_defn.svh"));
+    CHECK(defnPath == manager.makeAbsolutePath(findTestDir() + "/file_defn.svh"));
+    CHECK(manager.getIncludedBuffers(included[0]) == std::vector<BufferID>{ included[1] });
+
+    // Reading again normally hits the cache; after invalidation the file is read fresh,
+    // while the existing buffer keeps its contents.
+    string_view oldText = manager.getSourceText(included[1]);
+    CHECK(manager.readSource(defnPath).data.data() == oldText.data());
+
+    manager.invalidateFile(defnPath);
+    auto reread = manager.readSource(defnPath);
+    CHECK(reread.data.data() != oldText.data());
+    CHECK(reread.data == oldText);
+    CHECK(manager.getSourceText(included[1]) == oldText);
+}
@@ -1,5 +1,9 @@
 #include "Test.h"
 
+#include "slang/compilation/ConnectivityGraph.h"
+#include "slang/compilation/HierarchyIndex.h"
+#include "slang/symbols/ASTVisitor.h"
+
 TEST_CASE("Finding top level") {
     auto file1 = SyntaxTree::fromText(
         "module A; endmodule\nmodule B; A a(); endmodule\nmodule C; endmodule");
@@ -739,4 +743,451 @@ endmodule
 
     auto& asdf = compilation.getRoot().lookupName<GenerateBlockSymbol>("test.m.asdf");
     CHECK(asdf.isInstantiated);
-}
\ No newline at end of file
+}
+
+TEST_CASE("Definition specialization sharing") {
+    auto tree = SyntaxTree::fromText(R"(
+module leaf #(parameter int N = 4);
+    localparam int W = N * 2;
+    localparam logic [W-1:0] D = W + 1;
+    if (W > 8) begin : big
+        logic [W-1:0] data;
+    end
+    else begin : narrow
+    end
+endmodule
+
+module nonansi(a);
+    parameter int N = 4;
+    input a;
+endmodule
+
+module top;
+    leaf #(4) l0();
+    leaf #(4) l1();
+    leaf #(8) l2();
+    wire w;
+    nonansi n0(w);
+    nonansi n1(w);
+endmodule
+)");
+
+    Compilation compilation;
+    compilation.addSyntaxTree(tree);
+    NO_COMPILATION_ERRORS;
+
+    auto& root = compilation.getRoot();
+    CHECK(root.lookupName<ParameterSymbol>("top.l1.W").getValue().integer() == 8);
+    CHECK(root.lookupName<ParameterSymbol>("top.l1.D").getValue().integer() == 9);
+    CHECK(root.lookupName<ParameterSymbol>("top.l2.D").getValue().integer() == 17);
+    CHECK(root.lookupName<ParameterSymbol>("top.l2.D").getType().getBitWidth() == 16);
+
+    // Instances with the same parameter values share generate selections, but each
+    // binds its own parameters, which refer only to symbols in that instance.
+    auto getSpecialization = [&](string_view name) {
+        return root.lookupName<InstanceSymbol>(name).getSpecialization();
+    };
+    REQUIRE(getSpecialization("top.l0"));
+    CHECK(getSpecialization("top.l0") == getSpecialization("top.l1"));
+    CHECK(getSpecialization("top.l0") != getSpecialization("top.l2"));
+    CHECK(getSpecialization("top.l0")->generateSelections.size() == 1);
+
+    auto& l1W = root.lookupName<ParameterSymbol>("top.l1.W");
+    auto& init = l1W.getDeclaredType()->getInitializer()->as<BinaryExpression>().left();
+    CHECK(&init.as<NamedValueExpression>().symbol == &root.lookupName<ParameterSymbol>("top.l1.N"));
+
+    CHECK(root.lookupName<GenerateBlockSymbol>("top.l1.narrow").isInstantiated);
+    CHECK(!root.lookupName<GenerateBlockSymbol>("top.l1.big").isInstantiated);
+    CHECK(root.lookupName<GenerateBlockSymbol>("top.l2.big").isInstantiated);
+
+    // Non-ANSI ports are declared in the body and might be interface ports.
+    CHECK(!getSpecialization("top.n0"));
+
+    // Turning the cache off leaves every instance to evaluate its own conditions.
+    CompilationOptions coptions;
+    coptions.cacheDefinitionSpecializations = false;
+
+    Compilation compilation2(makeOptions(coptions));
+    compilation2.addSyntaxTree(tree);
+
+    auto& root2 = compilation2.getRoot();
+    CHECK(root2.lookupName<ParameterSymbol>("top.l1.D").getValue().integer() == 9);
+    CHECK(!root2.lookupName<InstanceSymbol>("top.l1").getSpecialization());
+    CHECK(!root2.lookupName<GenerateBlockSymbol>("top.l1.big").isInstantiated);
+}
+
+TEST_CASE("Generate loop indexing and shared selections") {
+    auto tree = SyntaxTree::fromText(R"(
+module top #(parameter int P = 3);
+    for (genvar i = 0; i < 4; i++) begin : gen
+        logic [i:0] sig;
+    end
+
+    for (genvar j = 10; j > 4; j -= 2) begin : inv
+        localparam int K = j / 2;
+        if (P > 2) begin : yes
+            logic [j:0] foo;
+        end
+        else begin : no
+        end
+        if (K > 3) begin : big
+        end
+        if (j > 7) begin : high
+        end
+    end
+
+    logic [2:0] a;
+    assign a = gen[2].sig;
+    logic b;
+    assign b = inv[6].yes.foo[0];
+endmodule
+)");
+
+    Compilation compilation;
+    compilation.addSyntaxTree(tree);
+    NO_COMPILATION_ERRORS;
+
+    auto& root = compilation.getRoot();
+    auto& gen = root.lookupName<GenerateBlockArraySymbol>("top.gen");
+    CHECK(gen.getNumIterations() == 4);
+    REQUIRE(gen.getEntries().size() == 4);
+    CHECK(gen.getEntry(3) == gen.getEntries()[3]);
+    CHECK(gen.getEntry(4) == nullptr);
+
+    auto& inv = root.lookupName<GenerateBlockArraySymbol>("top.inv");
+    REQUIRE(inv.getEntries().size() == 3);
+    CHECK(inv.getEntry(8) == inv.getEntries()[1]);
+    CHECK(inv.getEntry(7) == nullptr);
+    for (auto entry : inv.getEntries()) {
+        CHECK(entry->find<GenerateBlockSymbol>("yes").isInstantiated);
+        CHECK(!entry->find<GenerateBlockSymbol>("no").isInstantiated);
+        CHECK(entry->find<GenerateBlockSymbol>("big").isInstantiated == (entry->arrayIndex > 6));
+        CHECK(entry->find<GenerateBlockSymbol>("high").isInstantiated ==
+              (entry->arrayIndex > 7));
+    }
+
+    // Only the condition that doesn't depend on the genvar, directly or through
+    // something declared in the loop body, is shared between iterations.
+    CHECK(inv.getSharedSelections()->size() == 1);
+
+    auto tree2 = SyntaxTree::fromText(R"(
+module bad;
+    for (genvar i = 0; i < 2; i++) begin : gen
+        logic sig;
+    end
+    logic c;
+    assign c = gen[5].sig;
+endmodule
+)");
+
+    Compilation compilation2;
+    compilation2.addSyntaxTree(tree2);
+
+    auto& diags = compilation2.getAllDiagnostics();
+    REQUIRE(diags.size() == 1);
+    CHECK(diags[0].code == DiagCode::ScopeIndexOutOfRange);
+}
+
+TEST_CASE("Connectivity graph") {
+    auto tree = SyntaxTree::fromText(R"(
+module leaf(input logic [3:0] i, output logic [3:0] o);
+    assign o = ~i;
+endmodule
+
+module top;
+    wire [7:0] a, b;
+    wire c;
+    leaf l0(.i(a[3:0]), .o(b[7:4]));
+    leaf l1(.i(b[7:4]), .o(b[3:0]));
+    assign c = a[5] & b[0];
+endmodule
+)");
+
+    Compilation compilation;
+    compilation.addSyntaxTree(tree);
+    NO_COMPILATION_ERRORS;
+
+    auto check = [](const ConnectivityGraph& graph) {
+        auto node = [&](string_view path) {
+            auto result = graph.findNode(path);
+            REQUIRE(result);
+            return *result;
+        };
+
+        auto drivers = graph.getDrivers(node("top.c"));
+        REQUIRE(drivers.size() == 2);
+        CHECK(graph.getPath(drivers[0].source) == "top.a");
+        CHECK(drivers[0].sourceRange == ConstantRange{ 5, 5 });
+        CHECK(graph.getPath(drivers[1].source) == "top.b");
+        CHECK(drivers[1].sourceRange == ConstantRange{ 0, 0 });
+        CHECK(drivers[1].kind == ConnectivityGraph::EdgeKind::Assign);
+
+        // b is driven in two halves by the two instances.
+        drivers = graph.getDrivers(node("top.b"));
+        REQUIRE(drivers.size() == 2);
+        CHECK(graph.getPath(drivers[0].source) == "top.l0.o");
+        CHECK(drivers[0].targetRange == ConstantRange{ 7, 4 });
+        CHECK(drivers[0].kind == ConnectivityGraph::EdgeKind::Port);
+        CHECK(graph.getPath(drivers[1].source) == "top.l1.o");
+        CHECK(drivers[1].targetRange == ConstantRange{ 3, 0 });
+
+        auto loads = graph.getLoads(node("top.b"));
+        REQUIRE(loads.size() == 2);
+        CHECK(graph.getPath(graph.edges()[loads[0]].target) == "top.c");
+        CHECK(graph.getPath(graph.edges()[loads[1]].target) == "top.l1.i");
+        CHECK(graph.edges()[loads[1]].sourceRange == ConstantRange{ 7, 4 });
+
+        CHECK(graph.getDrivers(node("top.l1.o"))[0].source == node("top.l1.i"));
+        CHECK(graph.getDrivers(node("top.a")).empty());
+    };
+
+    auto graph = ConnectivityGraph::build(compilation.getRoot(), 4);
+    CHECK(graph.numNodes() == 7);
+    CHECK(graph.edges().size() == 8);
+    CHECK(graph.getSymbol(*graph.findNode("top.a")) ==
+          &compilation.getRoot().lookupName<NetSymbol>("top.a"));
+    check(graph);
+
+    std::stringstream stream;
+    graph.save(stream);
+
+    auto loaded = ConnectivityGraph::load(stream);
+    CHECK(loaded.numNodes() == 7);
+    CHECK(loaded.getKind(*loaded.findNode("top.l0.i")) == SymbolKind::Net);
+    CHECK(!loaded.getSymbol(0));
+    check(loaded);
+}
+
+TEST_CASE("Hierarchy index") {
+    auto tree = SyntaxTree::fromText(R"(
+module leaf(input logic clk);
+    logic q;
+endmodule
+
+module top;
+    logic clk;
+    leaf u1(.clk);
+    leaf arr[1:0](.clk);
+    for (genvar i = 0; i < 2; i++) begin : gen
+        leaf u(.clk);
+    end
+    if (1) begin
+        wire w;
+    end
+endmodule
+)");
+
+    Compilation compilation;
+    compilation.addSyntaxTree(tree);
+    NO_COMPILATION_ERRORS;
+
+    auto& root = compilation.getRoot();
+    auto index = HierarchyIndex::build(root);
+
+    for (auto path : { "top.u1.q", "top.arr[0].clk", "top.gen[1].u.q", "top.gen[1].i" }) {
+        auto entry = index.find(path);
+        REQUIRE(entry);
+        CHECK(index.getPath(*entry) == path);
+        CHECK(index.getSymbol(*entry) == root.lookupName(path));
+    }
+
+    SmallVectorSized<uint32_t, 8> results;
+    index.glob("top.genblk*.w", results);
+    CHECK(results.size() == 1);
+
+    CHECK(index.getKind(*index.find("top.arr[1]")) == SymbolKind::ModuleInstance);
+    CHECK(index.getParent(*index.find("top.u1.q")) == index.find("top.u1"));
+    CHECK(!index.getParent(*index.find("top")));
+    CHECK(!index.find("top.u1.nope"));
+    CHECK(!index.find("top.u"));
+
+    auto paths = [&](const SmallVector<uint32_t>& entries) {
+        std::vector<std::string> result;
+        for (auto entry : entries)
+            result.emplace_back(index.getPath(entry));
+        return result;
+    };
+
+    results.clear();
+    index.glob("top.*.q", results);
+    CHECK(paths(results) == std::vector<std::string>{ "top.arr[0].q", "top.arr[1].q", "top.u1.q" });
+
+    results.clear();
+    index.glob("top.**.q", results);
+    CHECK(paths(results) == std::vector<std::string>{ "top.arr[0].q", "top.arr[1].q",
+                                                      "top.gen[0].u.q", "top.gen[1].u.q",
+                                                      "top.u1.q" });
+
+    auto [begin, end] = index.findPrefix("top.gen[0].");
+    CHECK(end - begin == 4);
+
+    std::stringstream stream;
+    index.save(stream);
+    std::string image = stream.str();
+
+    auto loaded = HierarchyIndex::load(stream);
+    CHECK(loaded.size() == index.size());
+    CHECK(!loaded.getSymbol(0));
+
+    std::vector<uint64_t> buffer(image.size() / sizeof(uint64_t) + 1);
+    memcpy(buffer.data(), image.data(), image.size());
+    auto mapped = HierarchyIndex::fromBuffer(
+        span<const char>(reinterpret_cast<const char*>(buffer.data()), ptrdiff_t(image.size())));
+
+    string_view queries[] = { "top.u1.clk", "top.missing", "top.gen[0].u" };
+    for (auto& other : { &loaded, &mapped }) {
+        SmallVectorSized<optional<uint32_t>, 4> found;
+        other->find(queries, found);
+        REQUIRE(found.size() == 3);
+        CHECK(found[0] == index.find("top.u1.clk"));
+        CHECK(!found[1]);
+        CHECK(other->getPath(*found[2]) == "top.gen[0].u");
+    }
+
+    auto bytes = reinterpret_cast<char*>(buffer.data());
+    auto data = span<const char>(bytes, ptrdiff_t(image.size()));
+    CHECK_THROWS(HierarchyIndex::fromBuffer(data.first(4)));
+
+    // The image is a 24 byte header (magic, version, entry count, bucket count,
+    // string size) followed by 24 byte entries and then the bucket table.
+    uint32_t numEntries, numBuckets;
+    memcpy(&numEntries, bytes + 12, sizeof(uint32_t));
+    memcpy(&numBuckets, bytes + 16, sizeof(uint32_t));
+    char* entries = bytes + 24;
+    char* table = entries + numEntries * 24;
+
+    // Out of order entries would break prefix queries.
+    std::swap_ranges(entries, entries + 24, entries + 24);
+    CHECK_THROWS(HierarchyIndex::fromBuffer(data));
+    std::swap_ranges(entries, entries + 24, entries + 24);
+
+    // Without an empty bucket, looking up a missing path would never terminate.
+    std::string savedTable(table, numBuckets * sizeof(uint32_t));
+    memset(table, 0, savedTable.size());
+    CHECK_THROWS(HierarchyIndex::fromBuffer(data));
+    memcpy(table, savedTable.data(), savedTable.size());
+    CHECK(HierarchyIndex::fromBuffer(data).size() == index.size());
+
+    bytes[0] = 'X';
+    CHECK_THROWS(HierarchyIndex::fromBuffer(data));
+}
+
+namespace {
+
+struct NetCollector : public ASTVisitor<NetCollector> {
+    std::vector<std::string> nets;
+    size_t numInstances = 0;
+
+    void handle(const NetSymbol& net) {
+        std::string path;
+        net.getHierarchicalPath(path);
+        nets.push_back(path);
+    }
+
+    void handle(const ModuleInstanceSymbol& instance) {
+        numInstances++;
+        visitDefault(instance);
+    }
+
+    bool shouldVisit(const Symbol& symbol) { return symbol.name != "skipped"; }
+
+    void merge(NetCollector&& other) {
+        nets.insert(nets.end(), other.nets.begin(), other.nets.end());
+        numInstances += other.numInstances;
+    }
+};
+
+} // namespace
+
+TEST_CASE("AST visitor filtering and parallel visits") {
+    auto tree = SyntaxTree::fromText(R"(
+module leaf;
+    wire w;
+endmodule
+
+module mid;
+    wire m;
+    leaf l1();
+    leaf l2();
+    leaf skipped();
+endmodule
+
+module top;
+    wire t;
+    mid m1();
+    mid m2();
+    if (0) begin : off
+        wire z;
+    end
+endmodule
+)");
+
+    Compilation compilation;
+    compilation.addSyntaxTree(tree);
+    NO_COMPILATION_ERRORS;
+
+    // Skip uninstantiated definitions to look only at the hierarchy.
+    NetCollector serial;
+    serial.prunedKinds.set(size_t(SymbolKind::Definition));
+    compilation.getRoot().visit(serial);
+    CHECK(serial.numInstances == 7);
+    CHECK(serial.nets.size() == 8);
+    CHECK(std::find(serial.nets.begin(), serial.nets.end(), "top.off.z") != serial.nets.end());
+
+    // Each instance's own members come before those of the instances beneath it,
+    // regardless of how the instances are split across threads.
+    std::vector<std::string> expected = { "top.t",      "top.off.z",   "top.m1.m",
+                                          "top.m1.l1.w", "top.m1.l2.w", "top.m2.m",
+                                          "top.m2.l1.w", "top.m2.l2.w" };
+    for (uint32_t numThreads : { 1u, 3u, 16u }) {
+        NetCollector parallel;
+        parallel.prunedKinds.set(size_t(SymbolKind::Definition));
+        visitParallel(compilation, parallel, numThreads);
+        CHECK(parallel.numInstances == serial.numInstances);
+        CHECK(parallel.nets == expected);
+    }
+
+    NetCollector filtered;
+    filtered.prunedKinds.set(size_t(SymbolKind::Definition));
+    filtered.handledKinds.reset();
+    filtered.handledKinds.set(size_t(SymbolKind::Net));
+    filtered.visitFlags &= ~VisitFlags::UninstantiatedBlocks;
+    visitParallel(compilation, filtered, 2);
+    CHECK(filtered.numInstances == 0);
+    CHECK(filtered.nets.size() == 7);
+}
+
+TEST_CASE("Parallel visits after aborting on the error limit") {
+    auto tree = SyntaxTree::fromText(R"(
+module leaf;
+    typedef logic [3:0] nibble_t;
+    nibble_t n;
+    wire w = n[0];
+endmodule
+
+module top;
+    wire t = a;
+    leaf l1();
+    leaf l2();
+endmodule
+)");
+
+    CompilationOptions coptions;
+    coptions.errorLimit = 1;
+    coptions.abortOnErrorLimit = true;
+    Compilation compilation(makeOptions(coptions));
+    compilation.addSyntaxTree(tree);
+    CHECK(compilation.getAllDiagnostics().size() == 1);
+    REQUIRE(compilation.isAborting());
+
+    // Semantic analysis stopped before reaching the leaf instances, so the parallel
+    // visit has to force them itself before splitting up the work.
+    std::vector<std::string> expected = { "top.t", "top.l1.w", "top.l2.w" };
+    for (uint32_t numThreads : { 1u, 3u }) {
+        NetCollector parallel;
+        parallel.prunedKinds.set(size_t(SymbolKind::Definition));
+        parallel.visitFlags |= VisitFlags::ResolveTypes;
+        visitParallel(compilation, parallel, numThreads);
+        CHECK(parallel.nets == expected);
+    }
+}
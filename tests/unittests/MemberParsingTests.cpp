@@ -144,4 +144,51 @@ a1: assert property (@(posedge clk) a |-> p3);
     REQUIRE(coverStatement);
     REQUIRE(assertStatement);
     CHECK_DIAGNOSTICS_EMPTY;
-}
\ No newline at end of file
+}
+
+TEST_CASE("Parallel chunked parsing") {
+    std::string text;
+    for (int i = 0; text.size() < (3 << 20); i++) {
+        text += "// module " + std::to_string(i) + "\nmodule m" + std::to_string(i) +
+                "(input a, output y);\n";
+        for (int j = 0; j < 20; j++)
+            text += "    INV u" + std::to_string(j) + " (.A(a), .Y(y)); /* endmodule */\n";
+        text += (i % 3) ? "endmodule\n\n" : "endmodule : m" + std::to_string(i) + "\n\n";
+    }
+
+    auto parse = [](const std::string& source, uint32_t numThreads) {
+        Bag options;
+        ParserOptions parserOptions;
+        parserOptions.numThreads = numThreads;
+        options.add(parserOptions);
+        return SyntaxTree::fromText(source, SyntaxTree::getDefaultSourceManager(), "source",
+                                    options);
+    };
+
+    auto checkSame = [](SyntaxTree& serial, SyntaxTree& parallel) {
+        auto& a = serial.root().as<CompilationUnitSyntax>();
+        auto& b = parallel.root().as<CompilationUnitSyntax>();
+        REQUIRE(a.members.size() == b.members.size());
+        for (size_t i = 0; i < a.members.size(); i++) {
+            CHECK(a.members[i]->parent == &a);
+            CHECK(b.members[i]->parent == &b);
+            CHECK(a.members[i]->sourceRange().start().offset() ==
+                  b.members[i]->sourceRange().start().offset());
+            CHECK(a.members[i]->sourceRange().end().offset() ==
+                  b.members[i]->sourceRange().end().offset());
+        }
+        CHECK(a.endOfFile.location().offset() == b.endOfFile.location().offset());
+        CHECK(serial.getMetadataMap().size() == parallel.getMetadataMap().size());
+        CHECK(report(serial.diagnostics()) == report(parallel.diagnostics()));
+        CHECK(a.toString() == b.toString());
+    };
+
+    auto serial = parse(text, 1);
+    auto parallel = parse(text, 4);
+    CHECK(serial->diagnostics().empty());
+    checkSame(*serial, *parallel);
+
+    // Errors cause the parallel attempt to be thrown away in favor of a serial parse.
+    text += "module bad; INV u (.A(a), .Y(y);\nendmodule\n";
+    checkSame(*parse(text, 1), *parse(text, 4));
+}
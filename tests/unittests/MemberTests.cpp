@@ -1,5 +1,8 @@
 #include "Test.h"
 #include <nlohmann/json.hpp>
+#include <sstream>
+
+#include "slang/symbols/ASTSerializer.h"
 
 TEST_CASE("Nets") {
     auto tree = SyntaxTree::fromText(R"(
@@ -121,6 +124,56 @@ endmodule
     output.dump();
 }
 
+TEST_CASE("Streaming AST serialization") {
+    auto tree = SyntaxTree::fromText(R"(
+package p1;
+    parameter int BLAH = 1;
+    typedef struct packed { logic [3:0] a; } s_t;
+endpackage
+
+module Top;
+    (* foo, bar = 1 *) wire foo;
+    assign foo = 1;
+
+    p1::s_t s;
+    enum { A, B = 5 } e;
+
+    for (genvar i = 0; i < 3; i++) begin : gen
+        localparam int j = i * 2;
+        Child child();
+    end
+
+    function logic func(logic bar);
+        return bar;
+    endfunction
+endmodule
+
+module Child;
+    string str = "quote\" and \\ slash";
+endmodule
+)");
+
+    Compilation compilation;
+    compilation.addSyntaxTree(tree);
+    NO_COMPILATION_ERRORS;
+
+    json expected = compilation.getRoot();
+
+    std::stringstream jsonStream;
+    ASTSerializer(jsonStream, ASTSerializer::Format::Json).serialize(compilation.getRoot());
+    CHECK(json::parse(jsonStream.str()) == expected);
+
+    std::stringstream binaryStream;
+    ASTSerializer(binaryStream, ASTSerializer::Format::Binary).serialize(compilation.getRoot());
+    CHECK(binaryStream.str().size() < expected.dump().size());
+
+    BinaryASTReader reader(binaryStream);
+    CHECK(reader.readAll() == expected);
+
+    std::stringstream bad("not an AST");
+    CHECK_THROWS(BinaryASTReader(bad));
+}
+
 TEST_CASE("Simple attributes") {
     auto tree = SyntaxTree::fromText(R"(
 module m;
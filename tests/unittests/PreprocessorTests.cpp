@@ -1028,4 +1028,180 @@ TEST_CASE("Preprocessor API") {
     CHECK(pp.isDefined("FOO"));
     CHECK(pp.undefine("FOO"));
     CHECK(!pp.isDefined("FOO"));
-}
\ No newline at end of file
+}
+
+TEST_CASE("Repeated macro expansions") {
+    auto& text = R"(
+`define WIDTH 8
+`define FIELD(name, w) logic [w-1:0] name;
+`define DIR(d) `d
+`define PAIR(a, a) a a
+`define ONE 1
+
+`FIELD(foo, `WIDTH)
+`FIELD(bar, 4)
+`FIELD(baz, `WIDTH)
+`WIDTH `WIDTH
+`DIR(ONE) `DIR(WIDTH)
+`PAIR(x, y)
+)";
+
+    auto& expected = R"(
+logic [8-1:0] foo;
+logic [4-1:0] bar;
+logic [8-1:0] baz;
+8 8
+1 8
+x x
+)";
+
+    std::string result = preprocess(text);
+    CHECK(result == expected);
+    CHECK_DIAGNOSTICS_EMPTY;
+}
+
+TEST_CASE("Macro snapshots") {
+    diagnostics.clear();
+    Preprocessor pp(getSourceManager(), alloc, diagnostics);
+    pp.predefine("FOO 1");
+    pp.predefine("BAR 2");
+
+    auto snapshot = pp.getMacroSnapshot();
+    CHECK(pp.undefine("FOO"));
+    CHECK(!pp.isDefined("FOO"));
+    pp.predefine("BAZ");
+
+    Preprocessor pp2(getSourceManager(), alloc, diagnostics);
+    pp2.setMacros(snapshot);
+    CHECK(pp2.isDefined("FOO"));
+    CHECK(pp2.isDefined("BAR"));
+    CHECK(!pp2.isDefined("BAZ"));
+    CHECK(pp2.isDefined("__LINE__"));
+
+    pp2.pushSource("`undef BAR\n`ifdef FOO `FOO `endif");
+    Token token = pp2.next();
+    CHECK(token.kind == TokenKind::IntegerLiteral);
+    CHECK(!pp2.isDefined("BAR"));
+
+    // Lots of snapshots get collapsed but keep the same definitions.
+    for (int i = 0; i < 20; i++) {
+        pp.predefine("M" + std::to_string(i));
+        if (i % 2)
+            pp.undefine("M" + std::to_string(i - 1));
+        pp.getMacroSnapshot();
+    }
+
+    CHECK(pp.isDefined("M19"));
+    CHECK(!pp.isDefined("M18"));
+    CHECK(!pp.isDefined("FOO"));
+    CHECK(pp.isDefined("BAR"));
+    CHECK(pp.isDefined("BAZ"));
+
+    Preprocessor pp3(getSourceManager(), alloc, diagnostics);
+    pp3.setMacros(snapshot);
+    CHECK(pp3.isDefined("FOO"));
+    CHECK(!pp3.isDefined("M19"));
+    CHECK_DIAGNOSTICS_EMPTY;
+}
+
+TEST_CASE("Disabled text skipping") {
+    auto& text = R"(`ifdef NOPE
+    "string with `endif in it"
+    // comment with `else
+    /* block `elsif
+       comment */
+    \esc`endif foo `endifx `"bar`"
+    `define BLAH 1
+`elsif NOPE2 nothing here `else
+42
+`endif
+`ifndef __LINE__
+    1 2 3
+`endif)";
+
+    diagnostics.clear();
+    Preprocessor pp(getSourceManager(), alloc, diagnostics);
+    pp.pushSource(text);
+
+    Token token = pp.next();
+    REQUIRE(token.kind == TokenKind::IntegerLiteral);
+    CHECK(token.intValue() == 42);
+
+    Token eof = pp.next();
+    CHECK(eof.kind == TokenKind::EndOfFile);
+    CHECK(!pp.isDefined("BLAH"));
+
+    std::string str = SyntaxPrinter().setIncludeDirectives(true).print(token).print(eof).str();
+    CHECK(str == text);
+    CHECK_DIAGNOSTICS_EMPTY;
+
+    // The disabled text before the `elsif is kept as a single piece of trivia.
+    auto& branch = token.trivia()[0].syntax()->as<ConditionalBranchDirectiveSyntax>();
+    REQUIRE(branch.disabledTokens.size() == 1);
+    REQUIRE(branch.disabledTokens[0].trivia().size() == 1);
+    CHECK(branch.disabledTokens[0].trivia()[0].kind == TriviaKind::DisabledText);
+    CHECK(preprocess(text) == "\n42\n");
+}
+
+TEST_CASE("Discarding trivia") {
+    auto& text = R"(
+// leading comment
+`define STR(x) `"x  x`" /* comment */
+`define MULTI(a, b) a + \
+    b // trailing \
+    + 1
+module   m; /* block
+   comment */ localparam string s = `STR(foo   bar);
+    int i = `MULTI(1,
+        2);
+    `ifdef NOPE
+        disabled stuff
+    `endif
+    int j = `__LINE__; // done
+endmodule
+)";
+
+    auto lexAll = [&](bool discard) {
+        diagnostics.clear();
+        Bag options;
+        LexerOptions lexerOptions;
+        lexerOptions.discardTrivia = discard;
+        options.add(lexerOptions);
+
+        Preprocessor preprocessor(getSourceManager(), alloc, diagnostics, options);
+        preprocessor.pushSource(text);
+
+        std::vector<Token> tokens;
+        while (true) {
+            Token token = preprocessor.next();
+            tokens.push_back(token);
+            if (token.kind == TokenKind::EndOfFile)
+                break;
+        }
+
+        CHECK_DIAGNOSTICS_EMPTY;
+        return tokens;
+    };
+
+    auto full = lexAll(false);
+    auto lean = lexAll(true);
+    REQUIRE(full.size() == lean.size());
+
+    auto& sm = getSourceManager();
+    for (size_t i = 0; i < full.size(); i++) {
+        CHECK(full[i].kind == lean[i].kind);
+        CHECK(full[i].valueText() == lean[i].valueText());
+        CHECK(sm.getFullyExpandedLoc(full[i].location()).offset() ==
+              sm.getFullyExpandedLoc(lean[i].location()).offset());
+    }
+
+    // Tokens away from any directives only keep their line endings.
+    CHECK(lean[0].rawText() == "module");
+    for (auto& t : lean[0].trivia()) {
+        if (t.kind != TriviaKind::Directive)
+            CHECK(t.kind == TriviaKind::EndOfLine);
+    }
+
+    CHECK(lean[1].rawText() == "m");
+    CHECK(lean[1].trivia().empty());
+}
@@ -1,4 +1,9 @@
 #include "Test.h"
+#include <chrono>
+#include <fmt/format.h>
+
+#include "slang/syntax/SyntaxTree.h"
+#include "slang/syntax/SyntaxVisitor.h"
 
 TEST_CASE("If statement") {
     auto& text = "if (foo && bar &&& baz) ; else ;";
@@ -185,3 +190,56 @@ TEST_CASE("Nonblocking Event Trigger") {
     REQUIRE(stmt.kind == SyntaxKind::NonblockingEventTriggerStatement);
     CHECK(stmt.toString() == text);
 }
+
+TEST_CASE("Deep lookahead") {
+    // Disambiguating these requires scanning past all of the selects,
+    // which is far more lookahead than the parser normally needs.
+    std::string selects;
+    for (int i = 0; i < 100; i++)
+        selects += "[" + std::to_string(i) + "]";
+
+    auto text = "foo" + selects + " = 1;";
+    auto& stmt = parseStatement(text);
+    REQUIRE(stmt.kind == SyntaxKind::ExpressionStatement);
+    CHECK(stmt.toString() == text);
+
+    parseBlockDeclaration("foo::bar" + selects + " f;");
+}
+
+namespace {
+
+struct TokenCounter : public SyntaxVisitor<TokenCounter> {
+    size_t count = 0;
+    void visitToken(Token) { count++; }
+};
+
+} // namespace
+
+TEST_CASE("Parse throughput benchmark", "[.benchmark]") {
+    // Netlist-style input: lots of instances with named port connections,
+    // which is where token materialization dominates.
+    std::string text = "module top;\n";
+    for (int i = 0; i < 50000; i++)
+        text += fmt::format("    INV u{0} (.A(n{0}), .Y(n{1})); // cell {0}\n", i, i + 1);
+    text += "endmodule\n";
+
+    const int Iterations = 10;
+    size_t tokens = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < Iterations; i++) {
+        SourceManager sourceManager;
+        auto tree = SyntaxTree::fromText(text, sourceManager);
+
+        TokenCounter counter;
+        tree->root().visit(counter);
+        tokens = counter.count;
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    double seconds = std::chrono::duration<double>(elapsed).count() / Iterations;
+
+    CHECK(tokens > 0);
+    WARN(fmt::format("{} tokens, {:.1f} source bytes/token, {} bytes/token in memory "
+                     "(Token + Info), {:.2f}M tokens/sec",
+                     tokens, double(text.size()) / double(tokens),
+                     sizeof(Token) + sizeof(Token::Info), double(tokens) / seconds / 1e6));
+}
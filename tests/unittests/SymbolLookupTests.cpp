@@ -1,6 +1,7 @@
 #include "Test.h"
 
 #include "slang/compilation/Compilation.h"
+#include "slang/compilation/SemanticModel.h"
 #include "slang/syntax/SyntaxTree.h"
 
 TEST_CASE("Explicit import lookup") {
@@ -966,4 +967,150 @@ endmodule
     Compilation compilation;
     compilation.addSyntaxTree(tree);
     NO_COMPILATION_ERRORS;
-}
\ No newline at end of file
+}
+
+TEST_CASE("Semantic model location index") {
+    std::string text = R"(
+module leaf(input logic [3:0] a, output logic [3:0] b);
+    assign b = a;
+endmodule
+
+module top;
+    typedef logic [3:0] nibble_t;
+    nibble_t x, y, z;
+    function automatic nibble_t inc(nibble_t v);
+        return v + 1;
+    endfunction
+    leaf l1(.a(x), .b(y));
+    always_comb begin
+        if (x == 0)
+            z = inc(x);
+    end
+endmodule
+)";
+    auto tree = SyntaxTree::fromText(text);
+
+    Compilation compilation;
+    compilation.addSyntaxTree(tree);
+    NO_COMPILATION_ERRORS;
+
+    SemanticModel model(compilation);
+    auto& unitSyntax = tree->root().as<CompilationUnitSyntax>();
+    model.indexCompilationUnit(unitSyntax);
+
+    BufferID buffer = tree->root().getFirstToken().location().buffer();
+    auto at = [&](string_view needle, uint32_t delta = 0) {
+        return SourceLocation(buffer, uint32_t(text.find(needle)) + delta);
+    };
+
+    auto& top = *compilation.getDefinition("top");
+    auto& x = *top.find("x");
+    auto& inc = *top.find("inc");
+
+    auto span = model.findSpan(at("x, y"));
+    REQUIRE(span);
+    CHECK(span->symbol == &x);
+    CHECK(span->isDeclaration);
+
+    // References resolve to their declarations, from anywhere inside the name.
+    span = model.findSpan(at("x == 0"));
+    REQUIRE(span);
+    CHECK(span->symbol == &x);
+    CHECK(!span->isDeclaration);
+    CHECK(model.getSymbolAt(at(".a(x)", 3)) == &x);
+    CHECK(model.getSymbolAt(at("inc(x)", 2)) == &inc);
+    CHECK(model.getSymbolAt(at("inc(x)", 4)) == &x);
+    CHECK(model.getSymbolAt(at("v + 1")) == top.find("inc")->as<Scope>().find("v"));
+    CHECK(model.getSymbolAt(at("nibble_t x")) == top.find("nibble_t"));
+    CHECK(model.getSymbolAt(at("leaf l1")) == compilation.getDefinition("leaf"));
+    CHECK(model.getSymbolAt(at("l1")) == top.find("l1"));
+    CHECK(model.getSymbolAt(at("b = a", 4)) == compilation.getDefinition("leaf")->find("a"));
+
+    // Whitespace, keywords, and literals don't name anything.
+    CHECK(!model.getSymbolAt(at("== 0", 1)));
+    CHECK(!model.getSymbolAt(at("always_comb")));
+    CHECK(!model.getSymbolAt(at("0)")));
+
+    // Declarations are also added to the syntax cache.
+    CHECK(model.getDeclaredSymbol(*inc.getSyntax()) == &inc);
+
+    auto spans = model.getSpans(buffer);
+    CHECK(std::is_sorted(spans.begin(), spans.end(),
+                         [](auto& a, auto& b) { return a.start < b.start; }));
+
+    size_t references = 0;
+    for (auto& s : spans) {
+        if (s.symbol == &x && !s.isDeclaration)
+            references++;
+    }
+    CHECK(references == 3);
+
+    // Indexing again doesn't duplicate anything.
+    size_t count = spans.size();
+    model.indexCompilationUnit(unitSyntax);
+    CHECK(model.getSpans(buffer).size() == count);
+}
+
+TEST_CASE("Packages from attached compilations") {
+    auto pkgTree = SyntaxTree::fromText(R"(
+package p;
+    typedef bit [7:0] byte_t;
+    typedef enum { RED, GREEN } color_t;
+    parameter int WIDTH = 4;
+    function automatic int dbl(int x); return x * 2; endfunction
+endpackage
+)");
+
+    CompilationOptions coptions;
+    coptions.memoizeConstantFunctions = true;
+
+    Compilation fragment(makeOptions(coptions));
+    fragment.addSyntaxTree(pkgTree);
+    CHECK(fragment.getAllDiagnostics().empty());
+
+    Compilation unfrozen;
+    CHECK_THROWS_AS(unfrozen.attach(fragment), std::logic_error);
+
+    fragment.freeze();
+    CHECK(fragment.isFrozen());
+    CHECK(fragment.isFinalized());
+
+    auto tree = SyntaxTree::fromText(R"(
+module top;
+    import p::*;
+    byte_t b;
+    bit [7:0] c = b;
+    color_t color = GREEN;
+    logic [p::WIDTH-1:0] w;
+    localparam int D = dbl(WIDTH) + p::dbl(WIDTH);
+endmodule
+)");
+
+    Compilation compilation(makeOptions(coptions));
+    compilation.attach(fragment);
+    compilation.addSyntaxTree(tree);
+    NO_COMPILATION_ERRORS;
+
+    auto& package = *compilation.getPackage("p");
+    CHECK(&package == fragment.getPackage("p"));
+
+    auto& top = *compilation.getRoot().topInstances[0];
+    CHECK(top.find<VariableSymbol>("w").getType().getBitWidth() == 4);
+    CHECK(top.find<ParameterSymbol>("D").getValue().integer() == 16);
+
+    // Built-in types aren't shared between compilations but still match.
+    auto& b = top.find<VariableSymbol>("b");
+    CHECK(b.getType().isMatching(top.find<VariableSymbol>("c").getType()));
+    CHECK(package.find<ParameterSymbol>("WIDTH").getType().isMatching(
+        compilation.getIntType()));
+
+    // The fragment itself is never modified; calls into it are cached by the caller.
+    CHECK(fragment.getConstantFunctionCacheStats().entries == 0);
+    CHECK(compilation.getConstantFunctionCacheStats().entries == 1);
+    CHECK(compilation.getConstantFunctionCacheStats().hits >= 1);
+
+    Compilation second;
+    CHECK_THROWS_AS(compilation.attach(fragment), std::logic_error);
+    second.attach(fragment);
+    CHECK(second.getPackage("p") == &package);
+}
@@ -166,6 +166,12 @@ inline const ExpressionSyntax& parseExpression(const std::string& text) {
     return parser.parseExpression();
 }
 
+inline Bag makeOptions(const CompilationOptions& coptions) {
+    Bag options;
+    options.add(coptions);
+    return options;
+}
+
 inline const ModuleInstanceSymbol& evalModule(std::shared_ptr<SyntaxTree> syntax,
                                               Compilation& compilation) {
     compilation.addSyntaxTree(syntax);
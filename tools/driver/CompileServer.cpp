@@ -0,0 +1,648 @@
+//------------------------------------------------------------------------------
+// CompileServer.cpp
+// Compile server mode for the driver, which keeps parsed files between requests.
+//
+// File is under the MIT license; see LICENSE for details
+//------------------------------------------------------------------------------
+#include <algorithm>
+#include <fmt/format.h>
+#include <fstream>
+#include <iostream>
+#if !defined(_WIN32)
+#    include <csignal>
+#    include <cstring>
+#    include <sys/socket.h>
+#    include <sys/stat.h>
+#    include <sys/un.h>
+#    include <unistd.h>
+#endif
+
+#include "Driver.h"
+#include "slang/syntax/AllSyntax.h"
+#include "slang/util/Hash.h"
+
+#if !defined(_WIN32)
+
+using namespace slang;
+
+namespace {
+
+uint64_t hashText(string_view text) {
+    // Buffers loaded by the source manager have a null terminator on the end.
+    if (!text.empty() && text.back() == '\0')
+        text.remove_suffix(1);
+
+    return fnv1a64(text.data(), text.size());
+}
+
+// Syntax trees, and a frozen compilation of the packages among them, kept warm by the compile
+// server between requests. Trees can only be shared by compilations that use the same source
+// manager, and only reused by requests that would have parsed them the same way, so the server
+// keeps one of these for each distinct set of include directories and preprocessor options.
+class Workspace {
+public:
+    SourceManager sourceManager;
+    Bag options;
+
+    // The total size of file contents that have been replaced since the workspace was
+    // created. Old contents can't be freed while any buffer still refers to them, so
+    // once this gets large enough the whole workspace is thrown away and started over.
+    uint64_t staleBytes = 0;
+
+    explicit Workspace(DriverOptions& driverOptions) : options(driverOptions.makeBag()) {
+        driverOptions.addDirectories(sourceManager);
+    }
+
+    // Gets the tree for the given file, reusing the cached one unless the file or anything
+    // it includes has changed since it was parsed. Returns nullptr if the file can't be read.
+    std::shared_ptr<SyntaxTree> getTree(const std::string& path) {
+        std::error_code ec;
+        std::string fullPath = fs::canonical(path, ec).string();
+        if (ec)
+            return nullptr;
+
+        auto it = trees.find(fullPath);
+        if (it != trees.end() && isCurrent(it->second))
+            return it->second.tree;
+
+        SourceBuffer buffer = sourceManager.readSource(fullPath);
+        if (!buffer)
+            return nullptr;
+
+        CachedTree entry;
+        entry.tree = SyntaxTree::fromBuffer(buffer, sourceManager, options);
+        entry.files.push_back(stamp(buffer.id));
+        for (BufferID included : sourceManager.getIncludedBuffers(buffer.id))
+            entry.files.push_back(stamp(included));
+
+        auto tree = entry.tree;
+        trees[fullPath] = std::move(entry);
+        return tree;
+    }
+
+    // Gets a frozen compilation of the given package-only trees, for requests to attach
+    // instead of elaborating the packages again. It's kept until a request comes along with
+    // different package trees or different compilation options. Returns nullptr if compiling
+    // the packages on their own produces any diagnostics; they then have to be compiled along
+    // with the rest of the design so that the output matches what the driver would produce.
+    const Compilation* getPackages(const std::vector<std::shared_ptr<SyntaxTree>>& packageTrees,
+                                   const Bag& requestOptions, const std::string& optionsKey) {
+        if (!packages || packageTrees != packageSources || optionsKey != packageOptionsKey) {
+            auto compilation = std::make_unique<Compilation>(requestOptions);
+            for (auto& tree : packageTrees)
+                compilation->addSyntaxTree(tree);
+            compilation->freeze();
+
+            packages = std::move(compilation);
+            packageSources = packageTrees;
+            packageOptionsKey = optionsKey;
+        }
+
+        if (!packages->getAllDiagnostics().empty())
+            return nullptr;
+        return packages.get();
+    }
+
+    uint64_t liveBytes() const {
+        uint64_t total = 0;
+        for (auto& [path, entry] : trees) {
+            for (auto& file : entry.files)
+                total += file.size;
+        }
+        return total;
+    }
+
+private:
+    struct FileStamp {
+        std::string path;
+        fs::file_time_type modified;
+        uintmax_t size;
+        uint64_t hash;
+
+        // Set if the file was modified so recently that it could still be changed again
+        // without its timestamp moving; such files have their contents checked every time.
+        bool racy;
+    };
+
+    struct CachedTree {
+        std::shared_ptr<SyntaxTree> tree;
+        std::vector<FileStamp> files;
+    };
+
+    static bool isRacy(fs::file_time_type modified) {
+        return fs::file_time_type::clock::now() - modified < std::chrono::seconds(2);
+    }
+
+    FileStamp stamp(BufferID buffer) const {
+        string_view text = sourceManager.getSourceText(buffer);
+        if (!text.empty() && text.back() == '\0')
+            text.remove_suffix(1);
+
+        FileStamp result;
+        result.path = sourceManager.getFullPath(buffer);
+        result.size = text.size();
+        result.hash = hashText(text);
+
+        std::error_code ec;
+        result.modified = fs::last_write_time(result.path, ec);
+        result.racy = ec || isRacy(result.modified);
+        return result;
+    }
+
+    // Checks whether all files used by the given tree are unchanged. Any that have
+    // changed are dropped from the source manager, so that they get read again.
+    bool isCurrent(CachedTree& entry) {
+        bool current = true;
+        for (auto& file : entry.files) {
+            std::error_code ec;
+            auto modified = fs::last_write_time(file.path, ec);
+            uintmax_t size = ec ? 0 : fs::file_size(file.path, ec);
+            if (!ec && size == file.size) {
+                if (modified == file.modified && !file.racy)
+                    continue;
+
+                // The timestamp changed, but that doesn't mean the contents did.
+                std::ifstream stream(file.path, std::ios::binary);
+                std::string text(size, '\0');
+                if (stream.read(text.data(), std::streamsize(size)) &&
+                    hashText(text) == file.hash) {
+                    file.modified = modified;
+                    file.racy = isRacy(modified);
+                    continue;
+                }
+            }
+
+            sourceManager.invalidateFile(file.path);
+            staleBytes += file.size;
+            current = false;
+        }
+        return current;
+    }
+
+    flat_hash_map<std::string, CachedTree> trees;
+
+    std::unique_ptr<Compilation> packages;
+    std::vector<std::shared_ptr<SyntaxTree>> packageSources;
+    std::string packageOptionsKey;
+};
+
+// Keeps the most recently used workspaces around, up to a fixed limit.
+class WorkspaceCache {
+public:
+    Workspace& get(DriverOptions& driverOptions) {
+        std::string key = getKey(driverOptions);
+        auto it = std::find_if(entries.begin(), entries.end(),
+                               [&](auto& entry) { return entry.first == key; });
+
+        if (it != entries.end() && it->second->staleBytes > it->second->liveBytes())
+            it->second = std::make_unique<Workspace>(driverOptions);
+        else if (it == entries.end()) {
+            if (entries.size() == MaxWorkspaces)
+                entries.pop_back();
+            entries.emplace_back(key, std::make_unique<Workspace>(driverOptions));
+            it = entries.end() - 1;
+        }
+
+        std::rotate(entries.begin(), it, it + 1);
+        return *entries.front().second;
+    }
+
+private:
+    static std::string getKey(const DriverOptions& options) {
+        std::string key;
+        auto append = [&](char tag, const std::string& value) {
+            key += tag;
+            key += value;
+            key += '\0';
+        };
+
+        for (auto& dir : options.includeDirs)
+            append('I', fs::canonical(dir).string());
+        for (auto& dir : options.includeSystemDirs)
+            append('S', fs::canonical(dir).string());
+        for (auto& define : options.defines)
+            append('D', define);
+        for (auto& undefine : options.undefines)
+            append('U', undefine);
+        return key;
+    }
+
+    static constexpr size_t MaxWorkspaces = 8;
+    std::vector<std::pair<std::string, std::unique_ptr<Workspace>>> entries;
+};
+
+void writeAll(int fd, const void* data, size_t size) {
+    auto ptr = static_cast<const char*>(data);
+    while (size) {
+        ssize_t written = write(fd, ptr, size);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0)
+            throw fmt::system_error(errno, "Unable to write to compile server socket");
+
+        ptr += written;
+        size -= size_t(written);
+    }
+}
+
+bool readAll(int fd, void* data, size_t size) {
+    auto ptr = static_cast<char*>(data);
+    while (size) {
+        ssize_t count = read(fd, ptr, size);
+        if (count < 0 && errno == EINTR)
+            continue;
+        if (count <= 0)
+            return false;
+
+        ptr += count;
+        size -= size_t(count);
+    }
+    return true;
+}
+
+sockaddr_un getSocketAddress(const std::string& path) {
+    sockaddr_un addr{};
+    if (path.size() >= sizeof(addr.sun_path))
+        throw std::runtime_error(fmt::format("Socket path '{}' is too long", path));
+
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    return addr;
+}
+
+// A request to the compile server is a 32-bit size followed by that many bytes holding
+// the client's working directory and its command line arguments, each null terminated.
+// The client's stdin, stdout, and stderr are passed along with the size, so that output
+// goes straight to wherever the client's would have gone. Once the request is done, the
+// server replies with the 32-bit exit code the client should return.
+const size_t NumPassedFds = 3;
+const uint32_t MaxRequestSize = 16 * 1024 * 1024;
+
+class CompileServer {
+public:
+    int run(const std::string& socketPath) {
+        // A socket left behind by an earlier server is replaced, but nothing else is.
+        struct stat info;
+        if (lstat(socketPath.c_str(), &info) == 0) {
+            if (!S_ISSOCK(info.st_mode)) {
+                throw std::runtime_error(
+                    fmt::format("'{}' already exists and is not a socket", socketPath));
+            }
+            unlink(socketPath.c_str());
+        }
+
+        // Requests can run anything the driver can do, including writing files, so
+        // only the user running the server gets to connect; see also isTrustedPeer.
+        listener = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listener < 0)
+            throw fmt::system_error(errno, "Unable to listen on '{}'", socketPath);
+
+        sockaddr_un addr = getSocketAddress(socketPath);
+        mode_t oldMask = umask(0077);
+        int result = bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+        umask(oldMask);
+        if (result < 0 || listen(listener, SOMAXCONN) < 0)
+            throw fmt::system_error(errno, "Unable to listen on '{}'", socketPath);
+
+        // Clients going away shouldn't take the server with them, and compilations
+        // run in child processes that nobody needs to wait for.
+        signal(SIGPIPE, SIG_IGN);
+        signal(SIGCHLD, SIG_IGN);
+
+        serverDir = fs::current_path();
+        for (size_t i = 0; i < NumPassedFds; i++)
+            serverFds[i] = dup(int(i));
+
+        fmt::print("Compile server listening on '{}'\n", socketPath);
+        fflush(stdout);
+
+        while (true) {
+            int conn = accept(listener, nullptr, nullptr);
+            if (conn < 0) {
+                if (errno == EINTR)
+                    continue;
+                throw fmt::system_error(errno, "Unable to accept connection");
+            }
+
+            std::vector<std::string> args;
+            int fds[NumPassedFds];
+            if (isTrustedPeer(conn) && receiveRequest(conn, args, fds)) {
+                for (size_t i = 0; i < NumPassedFds; i++) {
+                    dup2(fds[i], int(i));
+                    close(fds[i]);
+                }
+
+                handleRequest(conn, args);
+
+                flushOutput();
+                for (size_t i = 0; i < NumPassedFds; i++)
+                    dup2(serverFds[i], int(i));
+
+                std::error_code ec;
+                fs::current_path(serverDir, ec);
+            }
+            close(conn);
+        }
+    }
+
+private:
+    static void flushOutput() {
+        std::cout.flush();
+        fflush(stdout);
+        fflush(stderr);
+    }
+
+    static void reply(int conn, int exitCode) {
+        int32_t code = exitCode;
+        try {
+            writeAll(conn, &code, sizeof(code));
+        }
+        catch (const std::exception&) {
+            // The client has gone away; there's nobody left to tell.
+        }
+    }
+
+    static bool isTrustedPeer(int conn) {
+#if defined(SO_PEERCRED)
+        ucred cred;
+        socklen_t length = sizeof(cred);
+        if (getsockopt(conn, SOL_SOCKET, SO_PEERCRED, &cred, &length) < 0)
+            return false;
+        return cred.uid == geteuid();
+#else
+        uid_t uid;
+        gid_t gid;
+        return getpeereid(conn, &uid, &gid) == 0 && uid == geteuid();
+#endif
+    }
+
+    static bool receiveRequest(int conn, std::vector<std::string>& args,
+                               int (&fds)[NumPassedFds]) {
+        uint32_t size;
+        iovec iov{ &size, sizeof(size) };
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(fds))] = {};
+
+        msghdr msg{};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        ssize_t received = recvmsg(conn, &msg, 0);
+
+        // Whatever descriptors came along are now ours, even if the request turns out
+        // to be bad, so they need to be closed on every path that doesn't use them.
+        // Note that the control buffer is padded, so it can hold more than we asked for.
+        std::vector<int> receivedFds;
+        cmsghdr* cmsg = received < 0 ? nullptr : CMSG_FIRSTHDR(&msg);
+        if (cmsg && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+            receivedFds.resize((cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+            memcpy(receivedFds.data(), CMSG_DATA(cmsg), receivedFds.size() * sizeof(int));
+        }
+
+        auto fail = [&] {
+            for (int fd : receivedFds)
+                close(fd);
+            return false;
+        };
+
+        if (received != sizeof(size) || receivedFds.size() != NumPassedFds ||
+            (msg.msg_flags & MSG_CTRUNC) || size > MaxRequestSize) {
+            return fail();
+        }
+        std::copy(receivedFds.begin(), receivedFds.end(), fds);
+
+        std::string request(size, '\0');
+        if (!readAll(conn, request.data(), size))
+            return fail();
+
+        size_t start = 0;
+        for (size_t i = 0; i < request.size(); i++) {
+            if (request[i] == '\0') {
+                args.emplace_back(request, start, i - start);
+                start = i + 1;
+            }
+        }
+
+        if (args.size() < 2)
+            return fail();
+        return true;
+    }
+
+    // Runs with stdin, stdout, and stderr already pointing at the client's.
+    void handleRequest(int conn, std::vector<std::string>& args) {
+        DriverOptions driverOptions;
+        CLI::App cmd("SystemVerilog compiler");
+        driverOptions.addTo(cmd);
+
+        int exitCode = 0;
+        try {
+            fs::current_path(args[0]);
+
+            std::vector<char*> argv;
+            for (size_t i = 1; i < args.size(); i++)
+                argv.push_back(args[i].data());
+
+            try {
+                cmd.parse(int(argv.size()), argv.data());
+            }
+            catch (const CLI::ParseError& e) {
+                reply(conn, cmd.exit(e));
+                return;
+            }
+
+            if (!driverOptions.serverSocket.empty() || !driverOptions.connectSocket.empty()) {
+                fmt::print("error: requests to the compile server can't start another one\n");
+                reply(conn, 1);
+                return;
+            }
+
+            // Preprocessing only doesn't benefit from cached trees, so it runs from scratch.
+            if (driverOptions.onlyPreprocess) {
+                runInChild(conn, [&] { return runDriver(driverOptions); });
+                return;
+            }
+
+            // Trees are parsed here, in the server process, so that they stay cached
+            // for later requests; everything after that runs in a child process.
+            Workspace& workspace = workspaces.get(driverOptions);
+            bool anyErrors = false;
+            std::vector<std::shared_ptr<SyntaxTree>> trees;
+            for (const std::string& file : driverOptions.sourceFiles) {
+                auto tree = workspace.getTree(file);
+                if (!tree) {
+                    fmt::print("error: no such file or directory: '{}'\n", file);
+                    anyErrors = true;
+                    continue;
+                }
+                trees.push_back(std::move(tree));
+            }
+
+            if (trees.empty()) {
+                puts("error: no input files\n");
+                reply(conn, 1);
+                return;
+            }
+
+            Bag options = driverOptions.makeBag();
+            const Compilation* packages = nullptr;
+            if (canAttachPackages(driverOptions))
+                packages = splitPackages(workspace, trees, options, driverOptions);
+
+            runInChild(conn, [&] {
+                try {
+                    anyErrors |= !runCompiler(workspace.sourceManager, options, trees,
+                                              driverOptions, packages);
+                }
+                catch (const std::exception& e) {
+                    fmt::print("internal compiler error: {}\n", e.what());
+                    return 2;
+                }
+                return anyErrors ? 1 : 0;
+            });
+            return;
+        }
+        catch (const std::exception& e) {
+            fmt::print("{}\n", e.what());
+            exitCode = 3;
+        }
+        reply(conn, exitCode);
+    }
+
+    // Packages that are attached from a frozen compilation don't show up in the request's
+    // own AST, and their constant evaluations happen ahead of time, so requests that write
+    // out anything derived from the AST or profile constant functions can't use them.
+    static bool canAttachPackages(const DriverOptions& options) {
+        return options.astJsonFile.empty() && options.astBinaryFile.empty() &&
+               options.connectivityFile.empty() && options.hierarchyIndexFile.empty() &&
+               !options.profileConstexpr;
+    }
+
+    static bool isPackageOnly(const SyntaxTree& tree) {
+        auto& root = tree.root();
+        if (root.kind != SyntaxKind::CompilationUnit)
+            return false;
+
+        auto& members = root.as<CompilationUnitSyntax>().members;
+        return !members.empty() && std::all_of(members.begin(), members.end(), [](auto member) {
+            return member->kind == SyntaxKind::PackageDeclaration;
+        });
+    }
+
+    // Takes the trees that hold nothing but packages out of @a trees and returns the
+    // workspace's frozen compilation of them. If they can't be attached, @a trees is left
+    // alone and nullptr is returned.
+    static const Compilation* splitPackages(Workspace& workspace,
+                                            std::vector<std::shared_ptr<SyntaxTree>>& trees,
+                                            const Bag& options,
+                                            const DriverOptions& driverOptions) {
+        std::vector<std::shared_ptr<SyntaxTree>> packageTrees;
+        std::vector<std::shared_ptr<SyntaxTree>> otherTrees;
+        for (auto& tree : trees)
+            (isPackageOnly(*tree) ? packageTrees : otherTrees).push_back(tree);
+
+        if (packageTrees.empty())
+            return nullptr;
+
+        // The packages are only used if they compile without diagnostics, so the limits on
+        // reporting them don't matter, but the limits on constant evaluation do.
+        auto& co = driverOptions.coptions;
+        std::string optionsKey =
+            fmt::format("{} {} {} {}", co.maxConstexprDepth, co.maxConstexprSteps,
+                        driverOptions.maxConstexprTime, co.memoizeConstantFunctions);
+
+        auto packages = workspace.getPackages(packageTrees, options, optionsKey);
+        if (packages)
+            trees = std::move(otherTrees);
+        return packages;
+    }
+
+    // Runs the given function in a forked copy of the server, which replies to the client
+    // when it's done. Running each compilation in its own process lets them proceed in
+    // parallel, and nothing they do can affect the cached state.
+    template<typename TFunc>
+    void runInChild(int conn, TFunc&& func) {
+        flushOutput();
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(listener);
+            int exitCode = func();
+            flushOutput();
+            reply(conn, exitCode);
+            _exit(0);
+        }
+
+        if (pid < 0)
+            reply(conn, func());
+    }
+
+    WorkspaceCache workspaces;
+    fs::path serverDir;
+    int serverFds[NumPassedFds];
+    int listener = -1;
+};
+
+} // namespace
+
+int runClient(const std::string& socketPath, int argc, char** argv) {
+    // Everything is forwarded except for the option that sent us to the server.
+    std::string request = fs::current_path().string();
+    request += '\0';
+    for (int i = 0; i < argc; i++) {
+        string_view arg = argv[i];
+        if (arg == "--connect") {
+            i++;
+            continue;
+        }
+        if (arg.substr(0, 10) == "--connect=")
+            continue;
+
+        request += arg;
+        request += '\0';
+    }
+
+    // A server that turns the request away just hangs up, which should be reported
+    // as an error instead of killing the client.
+    signal(SIGPIPE, SIG_IGN);
+
+    int conn = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr = getSocketAddress(socketPath);
+    if (conn < 0 || connect(conn, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0)
+        throw fmt::system_error(errno, "Unable to connect to compile server at '{}'",
+                                socketPath);
+
+    uint32_t size = uint32_t(request.size());
+    iovec iov{ &size, sizeof(size) };
+
+    int fds[NumPassedFds] = { STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO };
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(fds))] = {};
+
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+    if (sendmsg(conn, &msg, 0) != sizeof(size))
+        throw fmt::system_error(errno, "Unable to send request to compile server");
+    writeAll(conn, request.data(), request.size());
+
+    int32_t exitCode;
+    if (!readAll(conn, &exitCode, sizeof(exitCode)))
+        throw std::runtime_error("Lost connection to the compile server");
+
+    close(conn);
+    return exitCode;
+}
+
+int runCompileServer(const std::string& socketPath) {
+    return CompileServer().run(socketPath);
+}
+
+#endif
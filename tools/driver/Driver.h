@@ -0,0 +1,159 @@
+//------------------------------------------------------------------------------
+// Driver.h
+// Options and entry points shared by the parts of the driver program.
+//
+// File is under the MIT license; see LICENSE for details
+//------------------------------------------------------------------------------
+#pragma once
+
+#include <CLI/CLI.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "slang/compilation/Compilation.h"
+#include "slang/parsing/Parser.h"
+#include "slang/parsing/Preprocessor.h"
+#include "slang/syntax/SyntaxTree.h"
+#include "slang/text/SourceManager.h"
+#include "slang/util/Bag.h"
+
+// Everything that can be set on the command line.
+struct DriverOptions {
+    std::vector<std::string> sourceFiles;
+    std::vector<std::string> includeDirs;
+    std::vector<std::string> includeSystemDirs;
+    std::vector<std::string> defines;
+    std::vector<std::string> undefines;
+
+    std::string astJsonFile;
+    std::string astBinaryFile;
+    std::string connectivityFile;
+    std::string hierarchyIndexFile;
+    std::string preprocessOutput;
+    std::string serverSocket;
+    std::string connectSocket;
+
+    bool onlyPreprocess = false;
+    bool lineMarkers = false;
+    uint32_t numThreads = 1;
+    bool profileConstexpr = false;
+    bool diagSummary = false;
+
+    slang::ParserOptions poptions;
+    slang::CompilationOptions coptions;
+    uint64_t maxConstexprTime = 0;
+
+    void addTo(CLI::App& cmd) {
+        cmd.add_option("files", sourceFiles, "Source files to compile");
+        cmd.add_option("-I,--include-directory", includeDirs,
+                       "Additional include search paths");
+        cmd.add_option("--include-system-directory", includeSystemDirs,
+                       "Additional system include search paths");
+        cmd.add_option("-D,--define-macro", defines,
+                       "Define <macro>=<value> (or 1 if <value> ommitted) in all source files");
+        cmd.add_option("-U,--undefine-macro", undefines,
+                       "Undefine macro name at the start of all source files");
+        cmd.add_flag("-E,--preprocess", onlyPreprocess,
+                     "Only run the preprocessor (and print preprocessed files to stdout)");
+        cmd.add_option("-o,--output", preprocessOutput,
+                       "Write preprocessed output to the specified file instead of stdout");
+        cmd.add_flag("--line-markers", lineMarkers,
+                     "Emit `line directives in preprocessed output to preserve source locations");
+        cmd.add_option("-j,--threads", numThreads,
+                       "Number of threads to use for preprocessing files in parallel (output "
+                       "stays in file order), for parsing large files, for rendering "
+                       "diagnostics, and for building the connectivity graph");
+
+        cmd.add_option(
+            "--ast-json", astJsonFile,
+            "Dump the compiled AST in JSON format to the specified file, or '-' for stdout");
+        cmd.add_option("--ast-binary", astBinaryFile,
+                       "Dump the compiled AST in compact binary format to the specified file, "
+                       "or '-' for stdout");
+
+        cmd.add_option("--connectivity-graph", connectivityFile,
+                       "Write the graph of drivers and loads for the design to the specified "
+                       "file");
+        cmd.add_option("--hierarchy-index", hierarchyIndexFile,
+                       "Write an index of all hierarchical paths in the design to the "
+                       "specified file");
+
+        cmd.add_option("--max-constexpr-depth", coptions.maxConstexprDepth,
+                       "Maximum depth of nested constant function calls (0 for no limit)");
+        cmd.add_option("--max-constexpr-steps", coptions.maxConstexprSteps,
+                       "Maximum number of steps allowed in a constant evaluation (0 for no "
+                       "limit)");
+        cmd.add_option("--max-constexpr-time", maxConstexprTime,
+                       "Maximum time in milliseconds allowed for a constant evaluation "
+                       "(0 for no limit)");
+        cmd.add_flag("--profile-constexpr", profileConstexpr,
+                     "Profile constant function calls and print the hottest functions");
+
+        cmd.add_option("--error-limit", coptions.errorLimit,
+                       "Maximum number of errors to report (0 for no limit)");
+        cmd.add_option("--max-diags-per-code", coptions.maxDiagsPerCode,
+                       "Maximum number of diagnostics to report of any one kind (0 for no "
+                       "limit)");
+        cmd.add_flag("--abort-on-error-limit", coptions.abortOnErrorLimit,
+                     "Stop elaborating the design once the error limit has been reached");
+        cmd.add_flag("--diag-summary", diagSummary,
+                     "Print the number of diagnostics issued of each kind");
+
+        cmd.add_option("--server", serverSocket,
+                       "Run as a compile server listening on the specified Unix socket, "
+                       "keeping parsed files cached between requests");
+        cmd.add_option("--connect", connectSocket,
+                       "Send the rest of the command line to the compile server listening on "
+                       "the specified socket, instead of compiling in this process");
+    }
+
+    void addDirectories(slang::SourceManager& sourceManager) const {
+        for (const std::string& dir : includeDirs)
+            sourceManager.addUserDirectory(string_view(dir));
+
+        for (const std::string& dir : includeSystemDirs)
+            sourceManager.addSystemDirectory(string_view(dir));
+    }
+
+    slang::Bag makeBag() {
+        slang::PreprocessorOptions ppoptions;
+        ppoptions.predefines = defines;
+        ppoptions.undefines = undefines;
+        ppoptions.predefineSource = "<command-line>";
+
+        poptions.numThreads = numThreads;
+        coptions.maxConstexprTime = std::chrono::milliseconds(maxConstexprTime);
+        coptions.profileConstantFunctions = profileConstexpr;
+
+        slang::Bag options;
+        options.add(ppoptions);
+        options.add(poptions);
+        options.add(coptions);
+        return options;
+    }
+};
+
+// Compiles the given trees and reports diagnostics and any other requested output.
+// If @a packages is given, it's a frozen compilation whose packages are attached
+// instead of being compiled again. Returns true if there were no diagnostics.
+bool runCompiler(slang::SourceManager& sourceManager, const slang::Bag& options,
+                 const std::vector<std::shared_ptr<slang::SyntaxTree>>& trees,
+                 const DriverOptions& driverOptions,
+                 const slang::Compilation* packages = nullptr);
+
+// Runs the driver in this process, as requested by the given options.
+// Returns the exit code for the process.
+int runDriver(DriverOptions& driverOptions);
+
+#if !defined(_WIN32)
+
+// Runs a compile server listening on the given Unix socket; see CompileServer.cpp.
+// Only returns by throwing an exception.
+int runCompileServer(const std::string& socketPath);
+
+// Sends the given command line to the compile server listening on the given socket
+// and waits for it to finish. Returns the exit code the server replied with.
+int runClient(const std::string& socketPath, int argc, char** argv);
+
+#endif
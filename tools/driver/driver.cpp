@@ -5,142 +5,463 @@
 // File is under the MIT license; see LICENSE for details
 //------------------------------------------------------------------------------
 
-#include <CLI/CLI.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <fmt/format.h>
-#include <nlohmann/json.hpp>
-
-#include "slang/compilation/Compilation.h"
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+#include "Driver.h"
+#include "slang/compilation/ConnectivityGraph.h"
+#include "slang/compilation/HierarchyIndex.h"
 #include "slang/diagnostics/DiagnosticWriter.h"
-#include "slang/parsing/Preprocessor.h"
+#include "slang/symbols/ASTSerializer.h"
 #include "slang/syntax/SyntaxPrinter.h"
-#include "slang/syntax/SyntaxTree.h"
-#include "slang/text/SourceManager.h"
 
 using namespace slang;
 
-void writeToFile(const std::string& fileName, const std::string& contents) {
-    auto onError = [&]() {
-        throw fmt::system_error(errno, "Unable to write AST to '{}'", fileName);
+void writeAST(Compilation& compilation, const std::string& fileName,
+              ASTSerializer::Format format) {
+    auto write = [&](std::ostream& stream) {
+        ASTSerializer serializer(stream, format);
+        serializer.serialize(compilation.getRoot());
+        stream.flush();
+        if (!stream)
+            throw fmt::system_error(errno, "Unable to write AST to '{}'", fileName);
     };
 
-    FILE* fp;
-    if (fileName == "-")
-        fp = stdout;
+    if (fileName == "-") {
+        write(std::cout);
+    }
     else {
-        fp = fopen(fileName.c_str(), "w");
-        if (!fp)
-            onError();
+        std::ofstream file(fileName, std::ios::binary);
+        if (!file)
+            throw fmt::system_error(errno, "Unable to write AST to '{}'", fileName);
+        write(file);
     }
+}
+
+void writeConnectivityGraph(Compilation& compilation, const std::string& fileName,
+                            uint32_t numThreads) {
+    auto graph = ConnectivityGraph::build(compilation.getRoot(), numThreads);
 
-    int rc = fputs(contents.c_str(), fp);
-    if (rc == EOF)
-        onError();
+    std::ofstream file(fileName, std::ios::binary);
+    if (file)
+        graph.save(file);
 
-    if (fp != stdout)
-        fclose(fp);
+    file.flush();
+    if (!file)
+        throw fmt::system_error(errno, "Unable to write connectivity graph to '{}'", fileName);
 }
 
-bool runPreprocessor(SourceManager& sourceManager, const Bag& options,
-                     const std::vector<SourceBuffer>& buffers) {
+void writeHierarchyIndex(Compilation& compilation, const std::string& fileName) {
+    auto index = HierarchyIndex::build(compilation.getRoot());
+
+    std::ofstream file(fileName, std::ios::binary);
+    if (file)
+        index.save(file);
+
+    file.flush();
+    if (!file)
+        throw fmt::system_error(errno, "Unable to write hierarchy index to '{}'", fileName);
+}
+
+// Turns a stream of preprocessed tokens back into text, handing it off to a sink
+// in chunks so that the full output never needs to be held in memory. Optionally
+// inserts `line directives so that downstream tools can map the text back to the
+// original source locations.
+class PreprocessedWriter {
+public:
+    using Sink = std::function<void(std::string&&)>;
+
+    PreprocessedWriter(const SourceManager& sourceManager, bool lineMarkers, Sink sink) :
+        sourceManager(sourceManager), lineMarkers(lineMarkers), sink(std::move(sink)) {}
+
+    void write(Token token) {
+        for (const auto& trivia : token.trivia())
+            printer.print(trivia);
+        std::string text = printer.takeText();
+
+        if (lineMarkers && token.kind != TokenKind::EndOfFile) {
+            // Any marker needs to go after the last newline in the leading trivia,
+            // so that the token keeps its indentation.
+            size_t lastNewline = text.find_last_of('\n');
+            if (lastNewline != std::string::npos) {
+                std::string rest = text.substr(lastNewline + 1);
+                text.resize(lastNewline + 1);
+                append(std::move(text));
+                text = std::move(rest);
+            }
+
+            if (atLineStart)
+                syncLocation(token.location());
+        }
+        append(std::move(text));
+
+        printer.setIncludeTrivia(false).print(token).setIncludeTrivia(true);
+        append(printer.takeText());
+    }
+
+    void finish() {
+        if (!chunk.empty())
+            sink(std::exchange(chunk, std::string()));
+    }
+
+private:
+    void append(std::string&& text) {
+        if (text.empty())
+            return;
+
+        currentLine += (uint32_t)std::count(text.begin(), text.end(), '\n');
+        atLineStart = text.back() == '\n';
+
+        chunk += text;
+        if (chunk.size() >= ChunkSize)
+            sink(std::exchange(chunk, std::string()));
+    }
+
+    // Makes sure the next text printed will be treated downstream as coming from
+    // the file and line of the given location. Must be called at the start of a line.
+    void syncLocation(SourceLocation location) {
+        location = sourceManager.getFullyExpandedLoc(location);
+        if (!location.buffer())
+            return;
+
+        uint32_t line = sourceManager.getLineNumber(location);
+        BufferID buffer = location.buffer();
+        if (buffer == currentBuffer && line == currentLine)
+            return;
+
+        // Small forward jumps in the same file are cheaper as blank lines.
+        if (buffer == currentBuffer && line > currentLine && line - currentLine <= 8) {
+            append(std::string(line - currentLine, '\n'));
+            return;
+        }
+
+        // Flag the marker as entering or leaving an include file where possible.
+        int level = 0;
+        if (currentBuffer) {
+            if (sourceManager.getIncludedFrom(buffer).buffer() == currentBuffer)
+                level = 1;
+            else if (sourceManager.getIncludedFrom(currentBuffer).buffer() == buffer)
+                level = 2;
+        }
+
+        std::string fileName;
+        for (char c : sourceManager.getFileName(location)) {
+            if (c == '\\' || c == '"')
+                fileName += '\\';
+            fileName += c;
+        }
+
+        append(fmt::format("`line {} \"{}\" {}\n", line, fileName, level));
+
+        currentBuffer = buffer;
+        currentLine = line;
+    }
+
+    static constexpr size_t ChunkSize = 64 * 1024;
+
+    const SourceManager& sourceManager;
+    SyntaxPrinter printer;
+    bool lineMarkers;
+    Sink sink;
+    std::string chunk;
+    BufferID currentBuffer;
+    uint32_t currentLine = 1;
+    bool atLineStart = true;
+};
+
+// Preprocesses a single buffer, streaming the output to the given sink.
+// Returns the text of any diagnostics that were issued.
+std::string preprocessBuffer(SourceManager& sourceManager, const Bag& options,
+                             const SourceBuffer& buffer, bool lineMarkers,
+                             PreprocessedWriter::Sink sink) {
     BumpAllocator alloc;
-    DiagnosticWriter writer(sourceManager);
+    Diagnostics diagnostics;
+    Preprocessor preprocessor(sourceManager, alloc, diagnostics, options);
+    preprocessor.pushSource(buffer);
+
+    PreprocessedWriter writer(sourceManager, lineMarkers, std::move(sink));
+    while (true) {
+        Token token = preprocessor.next();
+        writer.write(token);
+        if (token.kind == TokenKind::EndOfFile)
+            break;
+    }
+    writer.finish();
+
+    if (diagnostics.empty())
+        return {};
+
+    DiagnosticWriter diagWriter(sourceManager);
+    return diagWriter.report(diagnostics);
+}
+
+bool runPreprocessor(SourceManager& sourceManager, const Bag& options,
+                     const std::vector<SourceBuffer>& buffers, const std::string& outputFile,
+                     bool lineMarkers, uint32_t numThreads) {
+    FILE* out = stdout;
+    if (!outputFile.empty() && outputFile != "-") {
+        out = fopen(outputFile.c_str(), "wb");
+        if (!out)
+            throw fmt::system_error(errno, "Unable to open '{}' for writing", outputFile);
+    }
+
+    auto writeOut = [&](const std::string& text) {
+        if (fwrite(text.data(), 1, text.size(), out) != text.size())
+            throw fmt::system_error(errno, "Unable to write preprocessed output");
+    };
+
+    // Without line markers there's nothing in the output to separate the files,
+    // so print a header for each one.
+    auto writeHeader = [&](const SourceBuffer& buffer) {
+        if (!lineMarkers)
+            writeOut(fmt::format("{}:\n==============================\n",
+                                 sourceManager.getRawFileName(buffer.id)));
+    };
 
     bool success = true;
-    for (const SourceBuffer& buffer : buffers) {
-        Diagnostics diagnostics;
-        Preprocessor preprocessor(sourceManager, alloc, diagnostics, options);
-        preprocessor.pushSource(buffer);
-
-        SyntaxPrinter output;
-        while (true) {
-            Token token = preprocessor.next();
-            output.print(token);
-            if (token.kind == TokenKind::EndOfFile)
-                break;
+    auto reportDiags = [&](const std::string& diags) {
+        if (!diags.empty()) {
+            fmt::print(stderr, "{}", diags);
+            success = false;
         }
+    };
 
-        if (diagnostics.empty())
-            fmt::print("{}:\n", sourceManager.getRawFileName(buffer.id));
-        else {
-            fmt::print("%s", writer.report(diagnostics));
-            success = false;
+    numThreads = std::min(numThreads, (uint32_t)buffers.size());
+    if (numThreads <= 1) {
+        for (const SourceBuffer& buffer : buffers) {
+            writeHeader(buffer);
+            reportDiags(preprocessBuffer(sourceManager, options, buffer, lineMarkers,
+                                         [&](std::string&& text) { writeOut(text); }));
         }
+    }
+    else {
+        // Files are preprocessed in parallel, but written out in order. Each file gets a
+        // bounded queue of output chunks; workers block when their queue is full, which
+        // keeps memory usage bounded no matter how large the output gets.
+        struct FileOutput {
+            std::mutex mutex;
+            std::condition_variable cv;
+            std::deque<std::string> chunks;
+            std::string diagnostics;
+            bool done = false;
+        };
+        const size_t MaxQueuedChunks = 16;
+
+        std::vector<FileOutput> outputs(buffers.size());
+        std::atomic<size_t> nextBuffer = 0;
+        std::atomic<bool> cancelled = false;
+        std::vector<std::exception_ptr> errors(numThreads);
+
+        // Thrown from a sink to abandon a file once writing the output has failed.
+        struct Cancelled {};
+
+        auto worker = [&](uint32_t threadIndex) {
+            size_t index;
+            while (!cancelled && (index = nextBuffer++) < buffers.size()) {
+                FileOutput& output = outputs[index];
+                auto sink = [&output, &cancelled, MaxQueuedChunks](std::string&& text) {
+                    std::unique_lock lock(output.mutex);
+                    output.cv.wait(lock, [&] {
+                        return cancelled || output.chunks.size() < MaxQueuedChunks;
+                    });
+                    if (cancelled)
+                        throw Cancelled();
+
+                    output.chunks.push_back(std::move(text));
+                    output.cv.notify_all();
+                };
+
+                std::string diags;
+                try {
+                    diags = preprocessBuffer(sourceManager, options, buffers[index],
+                                             lineMarkers, sink);
+                }
+                catch (const Cancelled&) {
+                }
+                catch (...) {
+                    errors[threadIndex] = std::current_exception();
+                }
+
+                std::unique_lock lock(output.mutex);
+                output.diagnostics = std::move(diags);
+                output.done = true;
+                output.cv.notify_all();
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (uint32_t i = 0; i < numThreads; i++)
+            threads.emplace_back(worker, i);
+
+        try {
+            for (size_t i = 0; i < buffers.size(); i++) {
+                writeHeader(buffers[i]);
+
+                FileOutput& output = outputs[i];
+                while (true) {
+                    std::string text;
+                    {
+                        std::unique_lock lock(output.mutex);
+                        output.cv.wait(lock,
+                                       [&] { return output.done || !output.chunks.empty(); });
+                        if (output.chunks.empty())
+                            break;
+
+                        text = std::move(output.chunks.front());
+                        output.chunks.pop_front();
+                        output.cv.notify_all();
+                    }
+                    writeOut(text);
+                }
+                reportDiags(output.diagnostics);
+            }
+        }
+        catch (...) {
+            // Workers may be blocked waiting for us to drain their queues;
+            // wake them all up so they can give up before we report the error.
+            cancelled = true;
+            for (auto& output : outputs) {
+                std::unique_lock lock(output.mutex);
+                output.cv.notify_all();
+            }
+
+            for (auto& thread : threads)
+                thread.join();
+
+            if (out != stdout)
+                fclose(out);
+            throw;
+        }
+
+        for (auto& thread : threads)
+            thread.join();
 
-        fmt::print("==============================\n{}\n", output.str());
+        for (auto& error : errors) {
+            if (error)
+                std::rethrow_exception(error);
+        }
     }
+
+    if (out != stdout)
+        fclose(out);
     return success;
 }
 
-bool runCompiler(SourceManager& sourceManager, const Bag& options,
-                 const std::vector<SourceBuffer>& buffers, const std::string& astJsonFile) {
-
-    Compilation compilation;
-    for (const SourceBuffer& buffer : buffers)
-        compilation.addSyntaxTree(SyntaxTree::fromBuffer(buffer, sourceManager, options));
+void printConstantFunctionProfile(const SourceManager& sourceManager,
+                                  const Compilation& compilation) {
+    // Aggregate call sites per function, remembering the most expensive call site.
+    struct Entry {
+        ConstantCallProfile total;
+        ConstantCallProfile hottestSite;
+    };
+    std::vector<Entry> entries;
+    flat_hash_map<const SubroutineSymbol*, size_t> entryMap;
+
+    // Profiles are already sorted by time, so the first one seen for each function
+    // is its hottest call site.
+    for (auto& profile : compilation.getConstantCallProfile()) {
+        auto it = entryMap.find(profile.subroutine);
+        if (it == entryMap.end()) {
+            entryMap.emplace(profile.subroutine, entries.size());
+            entries.push_back({ profile, profile });
+            continue;
+        }
 
-    auto& diagnostics = compilation.getAllDiagnostics();
-    DiagnosticWriter writer(sourceManager);
-    fmt::print("{}", writer.report(diagnostics));
+        ConstantCallProfile& total = entries[it->second].total;
+        total.calls += profile.calls;
+        total.expressions += profile.expressions;
+        total.loopIterations += profile.loopIterations;
+        total.time += profile.time;
+    }
 
-    if (!astJsonFile.empty()) {
-        json output = compilation.getRoot();
-        writeToFile(astJsonFile, output.dump(2));
+    std::stable_sort(entries.begin(), entries.end(),
+                     [](auto& a, auto& b) { return a.total.time > b.total.time; });
+
+    const size_t MaxEntries = 20;
+    fmt::print("\nHottest constant functions:\n");
+    for (size_t i = 0; i < entries.size() && i < MaxEntries; i++) {
+        const ConstantCallProfile& total = entries[i].total;
+        SourceLocation loc = sourceManager.getFullyOriginalLoc(entries[i].hottestSite.callLocation);
+        double ms = std::chrono::duration<double, std::milli>(total.time).count();
+
+        fmt::print("  {:<30} {:>10.3f} ms {:>8} calls {:>10} exprs {:>10} iterations  "
+                   "(hottest call at {}:{})\n",
+                   total.subroutine->name, ms, total.calls, total.expressions,
+                   total.loopIterations, sourceManager.getFileName(loc),
+                   sourceManager.getLineNumber(loc));
     }
+}
 
-    return diagnostics.empty();
+void printDiagnosticSummary(Compilation& compilation) {
+    auto counts = compilation.getDiagnosticCounts();
+    std::vector<std::pair<DiagCode, uint32_t>> entries(counts.begin(), counts.end());
+    std::stable_sort(entries.begin(), entries.end(), [](auto& a, auto& b) {
+        return a.second != b.second ? a.second > b.second : toString(a.first) < toString(b.first);
+    });
+
+    fmt::print("\nDiagnostic summary:\n");
+    for (auto& [code, count] : entries)
+        fmt::print("  {:<40} {:>10}\n", toString(code), count);
 }
 
-int main(int argc, char** argv) try {
-    std::vector<std::string> sourceFiles;
-    std::vector<std::string> includeDirs;
-    std::vector<std::string> includeSystemDirs;
-    std::vector<std::string> defines;
-    std::vector<std::string> undefines;
+bool runCompiler(SourceManager& sourceManager, const Bag& options,
+                 const std::vector<std::shared_ptr<SyntaxTree>>& trees,
+                 const DriverOptions& driverOptions, const Compilation* packages) {
 
-    std::string astJsonFile;
+    Compilation compilation(options);
+    if (packages)
+        compilation.attach(*packages);
 
-    bool onlyPreprocess;
+    for (auto& tree : trees)
+        compilation.addSyntaxTree(tree);
 
-    CLI::App cmd("SystemVerilog compiler");
-    cmd.add_option("files", sourceFiles, "Source files to compile");
-    cmd.add_option("-I,--include-directory", includeDirs, "Additional include search paths");
-    cmd.add_option("--include-system-directory", includeSystemDirs,
-                   "Additional system include search paths");
-    cmd.add_option("-D,--define-macro", defines,
-                   "Define <macro>=<value> (or 1 if <value> ommitted) in all source files");
-    cmd.add_option("-U,--undefine-macro", undefines,
-                   "Undefine macro name at the start of all source files");
-    cmd.add_flag("-E,--preprocess", onlyPreprocess,
-                 "Only run the preprocessor (and print preprocessed files to stdout)");
-
-    cmd.add_option("--ast-json", astJsonFile,
-                   "Dump the compiled AST in JSON format to the specified file, or '-' for stdout");
+    uint32_t numThreads = driverOptions.numThreads;
+    auto& diagnostics = compilation.getAllDiagnostics();
+    DiagnosticWriter writer(sourceManager);
+    auto sink = [](std::string&& text) { fmt::print("{}", text); };
+    writer.report(diagnostics, sink, numThreads);
 
-    try {
-        cmd.parse(argc, argv);
-    }
-    catch (const CLI::ParseError& e) {
-        return cmd.exit(e);
+    if (compilation.errorLimitReached()) {
+        fmt::print("note: error limit of {} reached{}\n", compilation.getOptions().errorLimit,
+                   compilation.isAborting() ? "; elaboration was stopped early" : "");
     }
 
-    SourceManager sourceManager;
-    for (const std::string& dir : includeDirs)
-        sourceManager.addUserDirectory(string_view(dir));
+    if (driverOptions.diagSummary)
+        printDiagnosticSummary(compilation);
+
+    if (!driverOptions.astJsonFile.empty())
+        writeAST(compilation, driverOptions.astJsonFile, ASTSerializer::Format::Json);
+
+    if (!driverOptions.astBinaryFile.empty())
+        writeAST(compilation, driverOptions.astBinaryFile, ASTSerializer::Format::Binary);
 
-    for (const std::string& dir : includeSystemDirs)
-        sourceManager.addSystemDirectory(string_view(dir));
+    if (!driverOptions.connectivityFile.empty())
+        writeConnectivityGraph(compilation, driverOptions.connectivityFile, numThreads);
 
-    PreprocessorOptions ppoptions;
-    ppoptions.predefines = defines;
-    ppoptions.undefines = undefines;
-    ppoptions.predefineSource = "<command-line>";
+    if (!driverOptions.hierarchyIndexFile.empty())
+        writeHierarchyIndex(compilation, driverOptions.hierarchyIndexFile);
 
-    Bag options;
-    options.add(ppoptions);
+    if (compilation.getOptions().profileConstantFunctions)
+        printConstantFunctionProfile(sourceManager, compilation);
+
+    return diagnostics.empty();
+}
+
+int runDriver(DriverOptions& driverOptions) {
+    SourceManager sourceManager;
+    driverOptions.addDirectories(sourceManager);
+    Bag options = driverOptions.makeBag();
 
     bool anyErrors = false;
     std::vector<SourceBuffer> buffers;
-    for (const std::string& file : sourceFiles) {
+    for (const std::string& file : driverOptions.sourceFiles) {
         SourceBuffer buffer = sourceManager.readSource(file);
         if (!buffer) {
             fmt::print("error: no such file or directory: '{}'\n", file);
@@ -157,10 +478,18 @@ int main(int argc, char** argv) try {
     }
 
     try {
-        if (onlyPreprocess)
-            anyErrors |= !runPreprocessor(sourceManager, options, buffers);
-        else
-            anyErrors |= !runCompiler(sourceManager, options, buffers, astJsonFile);
+        if (driverOptions.onlyPreprocess) {
+            anyErrors |= !runPreprocessor(sourceManager, options, buffers,
+                                          driverOptions.preprocessOutput,
+                                          driverOptions.lineMarkers, driverOptions.numThreads);
+        }
+        else {
+            std::vector<std::shared_ptr<SyntaxTree>> trees;
+            for (const SourceBuffer& buffer : buffers)
+                trees.push_back(SyntaxTree::fromBuffer(buffer, sourceManager, options));
+
+            anyErrors |= !runCompiler(sourceManager, options, trees, driverOptions);
+        }
     }
     catch (const std::exception& e) {
         fmt::print("internal compiler error: {}\n", e.what());
@@ -169,7 +498,33 @@ int main(int argc, char** argv) try {
 
     return anyErrors ? 1 : 0;
 }
+
+int main(int argc, char** argv) try {
+    DriverOptions driverOptions;
+    CLI::App cmd("SystemVerilog compiler");
+    driverOptions.addTo(cmd);
+
+    try {
+        cmd.parse(argc, argv);
+    }
+    catch (const CLI::ParseError& e) {
+        return cmd.exit(e);
+    }
+
+    if (!driverOptions.serverSocket.empty() || !driverOptions.connectSocket.empty()) {
+#if defined(_WIN32)
+        puts("error: the compile server is not supported on this platform\n");
+        return 1;
+#else
+        if (!driverOptions.serverSocket.empty())
+            return runCompileServer(driverOptions.serverSocket);
+        return runClient(driverOptions.connectSocket, argc, argv);
+#endif
+    }
+
+    return runDriver(driverOptions);
+}
 catch (const std::exception& e) {
     fmt::print("{}\n", e.what());
     return 3;
-}
\ No newline at end of file
+}